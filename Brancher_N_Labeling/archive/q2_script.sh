@@ -1,61 +0,0 @@
-# mzn-gecode -s nqueen_med.mzn -D "n=10;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=20;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=30;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=40;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=50;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=60;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=70;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=80;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=90;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=100;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=110;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=120;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=130;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=140;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=150;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=160;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=170;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=180;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=190;" >> q2_mzn_med_result
-# mzn-gecode -s nqueen_med.mzn -D "n=200;" >> q2_mzn_med_result
-
-echo "10"
-mzn-gecode -s nqueen_min.mzn -D "n=10;" >> q2_mzn_min_result
-echo "20"
-mzn-gecode -s nqueen_min.mzn -D "n=20;" >> q2_mzn_min_result
-echo "30"
-mzn-gecode -s nqueen_min.mzn -D "n=30;" >> q2_mzn_min_result
-echo "40"
-mzn-gecode -s nqueen_min.mzn -D "n=40;" >> q2_mzn_min_result
-echo "50"
-mzn-gecode -s nqueen_min.mzn -D "n=50;" >> q2_mzn_min_result
-echo "60"
-mzn-gecode -s nqueen_min.mzn -D "n=60;" >> q2_mzn_min_result
-echo "70"
-mzn-gecode -s nqueen_min.mzn -D "n=70;" >> q2_mzn_min_result
-echo "80"
-mzn-gecode -s nqueen_min.mzn -D "n=80;" >> q2_mzn_min_result
-echo "90"
-mzn-gecode -s nqueen_min.mzn -D "n=90;" >> q2_mzn_min_result
-echo "100"
-mzn-gecode -s nqueen_min.mzn -D "n=100;" >> q2_mzn_min_result
-echo "110"
-mzn-gecode -s nqueen_min.mzn -D "n=110;" >> q2_mzn_min_result
-echo "120"
-mzn-gecode -s nqueen_min.mzn -D "n=120;" >> q2_mzn_min_result
-echo "130"
-mzn-gecode -s nqueen_min.mzn -D "n=130;" >> q2_mzn_min_result
-echo "140"
-mzn-gecode -s nqueen_min.mzn -D "n=140;" >> q2_mzn_min_result
-echo "150"
-mzn-gecode -s nqueen_min.mzn -D "n=150;" >> q2_mzn_min_result
-echo "160"
-mzn-gecode -s nqueen_min.mzn -D "n=160;" >> q2_mzn_min_result
-echo "170"
-mzn-gecode -s nqueen_min.mzn -D "n=170;" >> q2_mzn_min_result
-echo "180"
-mzn-gecode -s nqueen_min.mzn -D "n=180;" >> q2_mzn_min_result
-echo "190"
-mzn-gecode -s nqueen_min.mzn -D "n=190;" >> q2_mzn_min_result
-echo "200"
-mzn-gecode -s nqueen_min.mzn -D "n=200;" >> q2_mzn_min_result
@@ -1,21 +1,84 @@
 #include <gecode/driver.hh>
 #include <gecode/int.hh>
+#include <gecode/int/branch.hh>
 #include <gecode/minimodel.hh>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
+
 using namespace Gecode;
 using namespace std;
 
 
+// Knight neighbours of every square of an n x n board for sizes only
+// known at run time, laid out like KnightTable below: the deg[i-1]
+// neighbours of square i are nb[8*(i-1)] and on. The table of a size
+// is built once and shared by all spaces, so that a service process
+// keeps it between requests; sizeError bounds the sizes kept.
+class KnightNeighbours {
+public:
+    vector<int> nb;
+    vector<int> deg;
+
+    explicit KnightNeighbours(int n) : nb(8*n*n), deg(n*n) {
+        const int valid_move[8][2] = {
+            {-2,-1}, {-2,1}, {2,-1}, {2,1},
+            {1,-2}, {1,2}, {-1,-2}, {-1,2}
+        };
+        for (int v = 0; v < n*n; v ++)
+            for (int m = 0; m < 8; m ++) {
+                int r = v / n + valid_move[m][0];
+                int c = v % n + valid_move[m][1];
+                if (r >= 0 && r < n && c >= 0 && c < n)
+                    nb[8*v + deg[v]++] = r*n + c + 1;
+            }
+    }
+    // The table for n x n boards
+    static const KnightNeighbours& get(int n) {
+        static mutex lock;
+        static map<int, unique_ptr<KnightNeighbours> > tables;
+        lock_guard<mutex> l(lock);
+        unique_ptr<KnightNeighbours>& t = tables[n];
+        if (!t)
+            t.reset(new KnightNeighbours(n));
+        return *t;
+    }
+};
+
+
 class Move : public Propagator {
 protected:
     Int::IntView x0, x1;
-    int n;
+    const KnightNeighbours* table;
+    // Remove the values of y without a knight neighbour in z
+    ExecStatus prune(Space& home, Int::IntView y, Int::IntView z) const {
+        for (int i = y.min(); i <= y.max(); i ++) {
+            if (!y.in(i)) continue; // so that i is in the dom of y
+            const int* nb = &table->nb[8*(i-1)];
+            int d = table->deg[i-1];
+            int m = 0;
+            while (m < d && !z.in(nb[m]))
+                m ++;
+            if (m == d && me_failed(y.nq(home, i)))
+                return ES_FAILED;
+        }
+        return ES_OK;
+    }
 public:
     // posting
     Move(Space& home, Int::IntView y0, Int::IntView y1, int n) 
-        : Propagator(home), x0(y0), x1(y1), n(n) {
+        : Propagator(home), x0(y0), x1(y1), table(&KnightNeighbours::get(n)) {
         x0.subscribe(home,*this,Int::PC_INT_DOM);
         x1.subscribe(home,*this,Int::PC_INT_DOM);
     }
@@ -32,14 +95,14 @@ public:
         return sizeof(*this);
     }
     // copying
-    Move(Space& home, bool share, Move& p) 
-        : Propagator(home,share,p) {
-        n = p.n;
-        x0.update(home,share,p.x0);
-        x1.update(home,share,p.x1);
+    Move(Space& home, SHARE_PARAM Move& p) 
+        : Propagator(home, SHARE_ARG p) {
+        table = p.table;
+        x0.update(home, SHARE_ARG p.x0);
+        x1.update(home, SHARE_ARG p.x1);
     }
-    virtual Propagator* copy(Space& home, bool share) {
-        return new (home) Move(home,share,*this);
+    virtual Propagator* copy(Space& home SHARE_TAIL) {
+        return new (home) Move(home, SHARE_ARG *this);
     }
     // cost computation
     virtual PropCost cost(const Space&, const ModEventDelta&) const {
@@ -52,94 +115,312 @@ public:
     }
     // propagation
     virtual ExecStatus propagate(Space& home, const ModEventDelta&)  {
+        // Prune x1, then x0. Symmetric with prune x1.
+        GECODE_ES_CHECK(prune(home, x1, x0));
+        GECODE_ES_CHECK(prune(home, x0, x1));
+
+        if (x0.assigned() && x1.assigned())
+            return home.ES_SUBSUMED(*this);
+        else 
+            return ES_NOFIX;
+    }
+};
+
+// Knight neighbours of every square of an N x N board, generated at
+// compile time. Squares are numbered from 1 as in the model:
+// nb[i-1] lists the deg[i-1] neighbours of square i.
+template<int N>
+struct KnightTable {
+    int nb[N*N][8];
+    int deg[N*N];
+    constexpr KnightTable() : nb(), deg() {
         const int valid_move[8][2] = {
             {-2,-1}, {-2,1}, {2,-1}, {2,1},
             {1,-2}, {1,2}, {-1,-2}, {-1,2}
         };
-        // Prune x1
-        for(int i = x1.min(); i <= x1.max(); i ++){
-            if (!x1.in(i)) continue; // so that i is in the dom of x1
-            int x1_row = (i-1) / n;
-            int x1_col = (i-1) % n;
-
-            int to_delete = 1;
-            for(int m = 0; m < 8; m ++){
-                int valid_x0_row = x1_row + valid_move[m][0];
-                int valid_x0_col = x1_col + valid_move[m][1];
-                bool row_valid = (valid_x0_row >= 0 && valid_x0_row < n);
-                bool col_valid = (valid_x0_col >= 0 && valid_x0_col < n);
-                // If (1) row (2) col are valid, check (3) whether the move is in the dom
-                if (row_valid && col_valid && x0.in(valid_x0_row * n + valid_x0_col + 1)){
-                    to_delete = 0;
-                    break;
-                }
-            }
-            if (to_delete){
-                ModEvent me = x1.nq(home, i);
-                if (me_failed(me)) return ES_FAILED;
-            }
-        }
-        // Prune x0. Symmetric with prune x1.
-        for(int i = x1.min(); i <= x1.max(); i ++){
-            if (!x0.in(i)) continue; // so that i is in the dom of x1
-            int x0_row = (i-1) / n;
-            int x0_col = (i-1) % n;
-
-            int to_delete = 1;
-            for(int m = 0; m < 8; m ++){
-                int valid_x1_row = x0_row + valid_move[m][0];
-                int valid_x1_col = x0_col + valid_move[m][1];
-                bool row_valid = (valid_x1_row >= 0 && valid_x1_row < n);
-                bool col_valid = (valid_x1_col >= 0 && valid_x1_col < n);
-                // If (1) row (2) col are valid, check (3) whether the move is in the dom
-                if (row_valid && col_valid && x1.in(valid_x1_row * n + valid_x1_col + 1)){
-                    to_delete = 0;
-                    break;
-                }
+        for (int v = 0; v < N*N; v ++)
+            for (int m = 0; m < 8; m ++) {
+                int r = v / N + valid_move[m][0];
+                int c = v % N + valid_move[m][1];
+                if (r >= 0 && r < N && c >= 0 && c < N)
+                    nb[v][deg[v]++] = r*N + c + 1;
             }
-            if (to_delete){
-                ModEvent me = x0.nq(home, i);
-                if (me_failed(me)) return ES_FAILED;
-            }
-        }
+    }
+};
 
+// Move for a board size N known at compile time: the neighbours
+// come from KnightTable<N>, so propagation needs no division,
+// modulo or bounds checks.
+template<int N>
+class MoveN : public Propagator {
+protected:
+    Int::IntView x0, x1;
+    static constexpr KnightTable<N> table = KnightTable<N>();
+    // Remove the values of y without a knight neighbour in z
+    static ExecStatus prune(Space& home, Int::IntView y, Int::IntView z) {
+        for (int i = y.min(); i <= y.max(); i ++) {
+            if (!y.in(i)) continue;
+            const int* nb = table.nb[i-1];
+            int d = table.deg[i-1];
+            int m = 0;
+            while (m < d && !z.in(nb[m]))
+                m ++;
+            if (m == d && me_failed(y.nq(home, i)))
+                return ES_FAILED;
+        }
+        return ES_OK;
+    }
+public:
+    // posting
+    MoveN(Space& home, Int::IntView y0, Int::IntView y1)
+        : Propagator(home), x0(y0), x1(y1) {
+        x0.subscribe(home,*this,Int::PC_INT_DOM);
+        x1.subscribe(home,*this,Int::PC_INT_DOM);
+    }
+    static ExecStatus post(Space& home, Int::IntView x0, Int::IntView x1) {
+        (void) new (home) MoveN(home,x0,x1);
+        return ES_OK;
+    }
+    // disposal
+    virtual size_t dispose(Space& home) {
+        x0.cancel(home,*this,Int::PC_INT_DOM);
+        x1.cancel(home,*this,Int::PC_INT_DOM);
+        (void) Propagator::dispose(home);
+        return sizeof(*this);
+    }
+    // copying
+    MoveN(Space& home, SHARE_PARAM MoveN& p)
+        : Propagator(home, SHARE_ARG p) {
+        x0.update(home, SHARE_ARG p.x0);
+        x1.update(home, SHARE_ARG p.x1);
+    }
+    virtual Propagator* copy(Space& home SHARE_TAIL) {
+        return new (home) MoveN(home, SHARE_ARG *this);
+    }
+    // cost computation
+    virtual PropCost cost(const Space&, const ModEventDelta&) const {
+        return PropCost::binary(PropCost::LO);
+    }
+    // re-scheduling
+    virtual void reschedule(Space& home) {
+        x0.reschedule(home,*this,Int::PC_INT_DOM);
+        x1.reschedule(home,*this,Int::PC_INT_DOM);
+    }
+    // propagation
+    virtual ExecStatus propagate(Space& home, const ModEventDelta&) {
+        GECODE_ES_CHECK(prune(home, x1, x0));
+        GECODE_ES_CHECK(prune(home, x0, x1));
         if (x0.assigned() && x1.assigned())
             return home.ES_SUBSUMED(*this);
-        else 
+        else
             return ES_NOFIX;
     }
 };
 
+template<int N>
+constexpr KnightTable<N> MoveN<N>::table;
+
+// Post Move for an n x n board, specialised for the common sizes
+ExecStatus postMove(Space& home, Int::IntView x0, Int::IntView x1, int n) {
+    switch (n) {
+        case 6:  return MoveN<6>::post(home,x0,x1);
+        case 8:  return MoveN<8>::post(home,x0,x1);
+        case 10: return MoveN<10>::post(home,x0,x1);
+        case 12: return MoveN<12>::post(home,x0,x1);
+        case 16: return MoveN<16>::post(home,x0,x1);
+        default: return Move::post(home,x0,x1,n);
+    }
+}
+
 // Entrance Function for the customized propagator
 void move(Space& home, IntVar x, IntVar y, int n) {
     // constraint post function
     Int::IntView y0(x), y1(y);
-    if (Move::post(home,y0,y1,n) != ES_OK)
+    if (postMove(home,y0,y1,n) != ES_OK)
         home.fail();
 }
 
-class KnightsOption : public Options {
+// Brancher following Warnsdorff's rule: the next unassigned step x[i]
+// of the tour is tried first on the square with the fewest onward
+// moves, that is the fewest knight neighbours still in the domain of
+// x[i+1]. Ties go to the larger square, as with INT_VAL_MAX, except
+// with restarts: as in branchHeuristic, they are then broken randomly
+// so that every restart explores a different tree. With -nogoods, the
+// x[i] = v alternatives explored before a restart become nogoods.
+class warnsdorff : public Brancher {
+protected:
+    ViewArray<Int::IntView> x;
+    int n;
+    const KnightNeighbours* table;
+    mutable int start;
+    bool random;
+    Rnd r;
+    // choice definition
+    class PosVal : public Choice {
+    public:
+        int pos;
+        int val;
+        PosVal(const warnsdorff& b, int p, int v)
+            : Choice(b,2), pos(p), val(v) {}
+        virtual size_t size(void) const {
+            return sizeof(*this);
+        }
+        virtual void archive(Archive& e) const {
+            Choice::archive(e);
+            e << pos << val;
+        }
+    };
+    // number of knight neighbours of square v in the domain of y
+    int onward(int v, Int::IntView y) const {
+        int count = 0;
+        for (int m = 0; m < table->deg[v-1]; m ++)
+            if (y.in(table->nb[8*(v-1) + m]))
+                count ++;
+        return count;
+    }
+public:
+    warnsdorff(Home home, ViewArray<Int::IntView>& x0, int n0,
+               bool random0, unsigned int seed)
+        : Brancher(home), x(x0), n(n0), table(&KnightNeighbours::get(n0)),
+          start(0), random(random0) {
+        if (random) {
+            r = Rnd(seed);
+            home.notice(*this, AP_DISPOSE);
+        }
+    }
+    // posting
+    static void post(Home home, ViewArray<Int::IntView>& x, int n,
+                     bool random, unsigned int seed) {
+        (void) new (home) warnsdorff(home,x,n,random,seed);
+    }
+    // disposal
+    virtual size_t dispose(Space& home) {
+        if (random) {
+            home.ignore(*this, AP_DISPOSE);
+            r.~Rnd();
+        }
+        (void) Brancher::dispose(home);
+        return sizeof(*this);
+    }
+    // choice
+    virtual const Choice* choice(Space&) {
+        int p = start;
+        // the tour is closed, the step after the last one is x[0]
+        Int::IntView next = x[(p+1) % x.size()];
+        int best = x[p].max();
+        int fewest = 9;
+        unsigned int ties = 0;
+        for (Int::ViewValues<Int::IntView> v(x[p]); v(); ++v) {
+            int c = onward(v.val(), next);
+            if (c < fewest) {
+                fewest = c; best = v.val(); ties = 1;
+            } else if (c == fewest) {
+                // with restarts, each of the ties is taken with
+                // the same probability
+                ties ++;
+                if (!random || r(ties) == 0)
+                    best = v.val();
+            }
+        }
+        return new PosVal(*this,p,best);
+    }
+    virtual const Choice* choice(const Space&, Archive& e) {
+        int pos, val;
+        e >> pos >> val;
+        return new PosVal(*this, pos, val);
+    }
+    // copy
+    warnsdorff(Space& home, SHARE_PARAM warnsdorff& b)
+        : Brancher(home, SHARE_ARG b), n(b.n), table(b.table), start(b.start),
+          random(b.random) {
+        x.update(home, SHARE_ARG b.x);
+#if GECODE_VERSION_NUMBER >= 600000
+        r = b.r;
+#else
+        r.update(home, share, b.r);
+#endif
+    }
+    virtual Brancher* copy(Space& home SHARE_TAIL) {
+        return new (home) warnsdorff(home, SHARE_ARG *this);
+    }
+    // status
+    virtual bool status(const Space&) const {
+        for (int i = start; i < x.size(); i++)
+            if (!x[i].assigned()) {
+                start = i;
+                return true;
+            }
+        return false;
+    }
+    // commit
+    virtual ExecStatus commit(Space& home,
+                              const Choice& c,
+                              unsigned int a) {
+        const PosVal& pv = static_cast<const PosVal&>(c);
+        int pos=pv.pos, val=pv.val;
+        Trace::commit(home, a, pos, val);
+        if (a == 0)
+            return me_failed(x[pos].eq(home,val)) ? ES_FAILED : ES_OK;
+        else
+            return me_failed(x[pos].nq(home,val)) ? ES_FAILED : ES_OK;
+    }
+    // no-good literal, as for the choices of branch() with INT_VAL_MAX
+    virtual NGL* ngl(Space& home, const Choice& c, unsigned int a) const {
+        const PosVal& pv = static_cast<const PosVal&>(c);
+        if (a == 0)
+            return new (home) Int::Branch::EqNGL<Int::IntView>(home, x[pv.pos], pv.val);
+        else
+            return NULL;
+    }
+    // print
+    virtual void print(const Space&, const Choice& c, unsigned int a,
+                       std::ostream& o) const {
+        const PosVal& pv = static_cast<const PosVal&>(c);
+        int pos=pv.pos, val=pv.val;
+        if (a == 0)
+            o << "x[" << pos << "] = " << val;
+        else
+            o << "x[" << pos << "] != " << val;
+    }
+};
+
+void warnsdorff(Home home, const IntVarArgs& x, int n, const Options& opt) {
+    if (home.failed())
+        return;
+    ViewArray<Int::IntView> y(home,x);
+    warnsdorff::post(home,y,n,opt.restart() != RM_NONE,opt.seed());
+}
+
+// Knights specific value of the -branching option
+enum {
+    BRANCH_WARNSDORFF = BRANCH_MED + 1,
+};
+
+class KnightsOption : public DriverOptions {
 public:
     int n;
 
-    KnightsOption(const char* s, int n0)
-        : Options(s), n(n0) {}
+    KnightsOption(const char* s, int n0) : DriverOptions(s), n(n0) {
+        branching(BRANCH_WARNSDORFF);
+        branching(BRANCH_WARNSDORFF, "warnsdorff", "fewest onward moves first (default)");
+    }
 
     void parse(int& argc, char* argv[]) {
-        Options::parse(argc,argv);
+        DriverOptions::parse(argc,argv);
         if (argc < 2) return;
         n = atoi(argv[1]);
     }
 };
 
 
-class Knights : public Script {
+class Knights : public Script, public Trace::Depth {
 protected:
     int n;
     IntVarArray x;
 
 public:
     Knights(const KnightsOption& opt): Script(opt), n(opt.n){
+        Trace::failures(*this);
         x = IntVarArray(*this, n*n, 1, n*n);
 
         for(int i = 0; i < n*n-1; i ++)
@@ -149,11 +430,17 @@ public:
         distinct(*this, x);
 
         rel(*this, x[0] == 1);
-        rel(*this, x[26] == 22);
-        rel(*this, x[17] == 23);
-        rel(*this, x[8] == 25);
+        // the given squares of the 6x6 puzzle
+        if (n == 6) {
+            rel(*this, x[26] == 22);
+            rel(*this, x[17] == 23);
+            rel(*this, x[8] == 25);
+        }
 
-        branch(*this, x, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+        if (opt.branching() == BRANCH_WARNSDORFF)
+            warnsdorff(*this, x, n, opt);
+        else
+            branchHeuristic(*this, x, opt);
     }
     
     virtual void print(ostream& os) const {
@@ -164,34 +451,73 @@ public:
         // Print the keyboard
         for(int i = 0; i < n; i ++){
             for (int j = 0; j < n; j ++){
-                cout << y[i*n + j] << ", ";
+                os << y[i*n + j] << ", ";
             }
-            cout << endl;
+            os << endl;
         }
         os << endl;
     }
     // Copy constructor
-    Knights(bool share, Knights& old_k): Script(share, old_k) {
+    Knights(SHARE_PARAM Knights& old_k): Script(SHARE_ARG old_k), Trace::Depth(old_k) {
         n = old_k.n;
-        x.update(*this, share, old_k.x);
+        x.update(*this, SHARE_ARG old_k.x);
     }
 
-    virtual Space* copy(bool share) {
-        return new Knights(share, *this);
+    virtual Space* copy(SHARE_VOID) {
+        return new Knights(SHARE_ARG *this);
     }
 };
 
 
+void parseOptions(KnightsOption& opt, int& argc, char* argv[]) {
+    opt.restartDefaults();
+    opt.parse(argc, argv);
+    opt.restartSolutions();
+}
+
+// Largest board accepted: the model has n*n variables of n*n values,
+// and the table of knight neighbours of every size is kept for good
+const int MAX_BOARD = 64;
+
+// Why opt.n cannot be solved, or NULL
+const char* sizeError(const KnightsOption& opt) {
+    if (opt.n < 1)
+        return "the board needs at least one square";
+    if (opt.n > MAX_BOARD)
+        return "the board is larger than 64 x 64";
+    return NULL;
+}
+
+// Solve one service request
+bool serveKnights(int argc, char* argv[], ostream& os) {
+    KnightsOption opt("Knights Move", 6);
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (const char* error = sizeError(opt))
+        throw Exception("knight", error);
+    return Service::solve<Knights, DFS, KnightsOption>(opt, os);
+}
+
+// bench/bench.cpp includes the model with DRIVER_NO_MAIN defined.
+#ifndef DRIVER_NO_MAIN
 int main(int argc, char* argv[]) {
     KnightsOption opt("Knights Move", 6);  // by default, n = 6
-    opt.parse(argc, argv);
-    opt.solutions(0);
+    parseOptions(opt, argc, argv);
 
-    Script::run<Knights, DFS, KnightsOption>(opt);
+    if (opt.service()[0] != '\0')
+        return Service::serve(opt.service(), Service::threads(opt), serveKnights);
+    else if (const char* error = sizeError(opt)) {
+        cerr << argv[0] << ": " << error << endl;
+        return 1;
+    } else if (opt.processes() > 0)
+        Distributed::run<Knights, DFS, Solve::NoObjective>(opt, opt.processes());
+    else
+        Script::run<Knights, DFS, KnightsOption>(opt);
 
     return 0;
 }
+#endif
 
-// How I "Compile":
-// Copy and paste the code to overwrite one of the example cpp file
-// under gecode-5.0.0/examples. Then make && make install.
+// How to compile, from the repository root:
+//   cmake -S . -B build && cmake --build build
+// See CMakeLists.txt for the LTO and PGO configurations.
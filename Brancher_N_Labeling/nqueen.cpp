@@ -3,133 +3,90 @@
 #include <gecode/int.hh>
 #include <gecode/minimodel.hh>
 
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
 
 using namespace Gecode;
 using namespace std;
 
 
-class int_val_med : public Brancher { 
-protected: 
-    ViewArray<Int::IntView> x; 
-    mutable int start;
-    // choice definition 
-    class PosVal : public Choice { 
-    public: 
-        int pos; 
-        int val; 
-        PosVal(const int_val_med& b, int p, int v)
-            : Choice(b,2), pos(p), val(v) {} 
-        virtual size_t size(void) const {   
-            return sizeof(*this); 
-        }
-        virtual void archive(Archive& e) const { 
-            Choice::archive(e); 
-            e << pos << val; 
-        } 
-    }; 
-public: 
-    int_val_med(Home home, ViewArray<Int::IntView>& x0)
-        : Brancher(home), x(x0), start(0) {} 
-    //posting
-    static void post(Home home, ViewArray<Int::IntView>& x) { 
-        (void) new (home) int_val_med(home,x); 
-    } 
-    //disposal
-    virtual size_t dispose(Space& home) { 
-        (void) Brancher::dispose(home); 
-        return sizeof(*this); 
-    } 
-    //choice 
-    virtual const Choice*  choice(Space& home) {
-        // Find the variable with min domain
-        int p = start;
-        unsigned int s = x[p].size();
-        for (int i=start+1; i<x.size(); i++){
-            if (!x[i].assigned() && (x[i].size() < s)) {
-                p = i; s = x[p].size();
-            }            
-        }
-        // Find the m/2
-        int counter = x[p].size() / 2; // Loop until counter deduced to 1
-        int cur_val = x[p].min()-1;
-        while(counter > 0){
-            cur_val ++;
-            if (x[p].in(cur_val))
-                counter --;
-        }
-        return new PosVal(*this,p,cur_val);
-        // return new PosVal(*this,p,x[p].min());
+// Solution counting for n queens by backtracking over bit masks:
+// bit c of cols is set if column c holds a queen, ld and rd mark the
+// columns attacked in the current row along the two diagonals.
+unsigned long long countRows(unsigned long long all, unsigned long long cols,
+                             unsigned long long ld, unsigned long long rd) {
+    if (cols == all)
+        return 1;
+    unsigned long long count = 0;
+    unsigned long long free = all & ~(cols | ld | rd);
+    while (free) {
+        unsigned long long bit = free & (~free + 1);
+        free ^= bit;
+        count += countRows(all, cols | bit, ((ld | bit) << 1) & all, (rd | bit) >> 1);
     }
-    virtual const Choice*  choice(const Space& home, Archive& e) {
-        int pos, val;
-        e>>pos>>val;
-        return new PosVal(*this, pos, val);
-    }
-    //copy
-    int_val_med(Space& home, bool share, int_val_med& b) 
-        : Brancher(home,share,b), start(b.start) { 
-        x.update(home,share,b.x); 
-    } 
-    virtual Brancher* copy(Space& home, bool share) { 
-        return new (home) int_val_med(home,share,*this); 
-    }
-    // status 
-    virtual bool status(const Space& home) const { 
-        for (int i=start; i<x.size(); i++)
-            if(!x[i].assigned()){
-                start = i;
-                return true;
+    return count;
+}
+
+// Count the solutions for 1 <= n <= 63 with the given number of threads.
+// By mirror symmetry only the queens of the first row in the left
+// half are placed and counted twice. For odd n the queen in the middle
+// column is added, with the queen of the second row in the left half.
+// The placements of the first two rows are shared out among threads.
+unsigned long long countQueens(int n, unsigned int threads) {
+    if (n == 1)
+        return 1;
+    unsigned long long all = (1ULL << n) - 1;
+    vector<pair<int,int> > tasks; // columns of the queens in rows 0 and 1
+    for (int c0 = 0; c0 < (n+1)/2; c0 ++)
+        for (int c1 = 0; c1 < n; c1 ++) {
+            if (c1 >= c0-1 && c1 <= c0+1) continue;
+            if (n % 2 == 1 && c0 == n/2 && c1 >= n/2) continue;
+            tasks.push_back(make_pair(c0, c1));
+        }
+    atomic<unsigned int> next(0);
+    atomic<unsigned long long> total(0);
+    vector<thread> pool;
+    for (unsigned int t = 0; t < max(threads, 1u); t ++)
+        pool.push_back(thread([&]() {
+            unsigned long long count = 0;
+            for (unsigned int i = next++; i < tasks.size(); i = next++) {
+                unsigned long long b0 = 1ULL << tasks[i].first;
+                unsigned long long b1 = 1ULL << tasks[i].second;
+                count += countRows(all, b0 | b1, ((b0 << 2) | (b1 << 1)) & all,
+                                   (b0 >> 2) | (b1 >> 1));
             }
-        return false; 
-    } 
-    // commit 
-    virtual ExecStatus commit(Space& home, 
-                              const Choice& c, 
-                              unsigned int a) {
-        const PosVal& pv = static_cast<const PosVal&>(c); 
-        int pos=pv.pos, val=pv.val; 
-        if (a == 0) 
-            return me_failed(x[pos].eq(home,val)) ? ES_FAILED : ES_OK; 
-        else 
-            return me_failed(x[pos].nq(home,val)) ? ES_FAILED : ES_OK; 
-    } 
-    // print 
-    virtual void print(const Space& home, const Choice& c, unsigned int a, std::ostream& o) const { 
-        const PosVal& pv = static_cast<const PosVal&>(c); 
-        int pos=pv.pos, val=pv.val; 
-        if (a == 0) 
-            o << "x[" << pos << "] = " << val; 
-        else 
-            o << "x[" << pos << "] != " << val; 
-    } 
-}; 
-
- void int_val_med(Home home, const IntVarArgs& x) { 
-    if (home.failed()) 
-        return; 
-    ViewArray<Int::IntView> y(home,x); 
-    int_val_med::post(home,y); 
- } 
-
-
-
-class NQueensOption : public Options {
+            total += 2 * count;
+        }));
+    for (unsigned int t = 0; t < pool.size(); t ++)
+        pool[t].join();
+    return total;
+}
+
+
+class NQueensOption : public DriverOptions {
 public:
     int n;
 
-    NQueensOption(const char* s, int n0)
-        : Options(s), n(n0) {}
+    NQueensOption(const char* s, int n0) : DriverOptions(s), n(n0) {}
 
     void parse(int& argc, char* argv[]) {
-        Options::parse(argc,argv);
+        DriverOptions::parse(argc,argv);
         if (argc < 2) return;
         n = atoi(argv[1]);
     }
 };
 
 
-class NQueens : public Space {
+class NQueens : public Space, public Trace::Depth {
 protected:
     IntVarArray sol;
     int n;
@@ -139,8 +96,14 @@ public:
     SEARCH_ONE,
     SEARCH_TWO,
     };
+    enum {
+    MODEL_CP,    // enumerate with this space
+    MODEL_COUNT, // count with countQueens
+    MODEL_CHECK, // compare both counts for 1..n
+    };
 
     NQueens(const NQueensOption& opt): n(opt.n){
+        Trace::failures(*this);
         sol = IntVarArray(*this, n, 1, n);
         n = n;
         for (int i = 0; i<n; i++)
@@ -151,44 +114,142 @@ public:
             } 
         switch (opt.search()){
             case SEARCH_ONE: {
-                cout << "solve using search one\n";
-                branch(*this, sol, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                opt.messages() << "solve using search one\n";
+                branchHeuristic(*this, sol, opt);
             }  break;
             case SEARCH_TWO: {
-                cout << "solve using search two\n";
+                opt.messages() << "solve using search two\n";
                 // branch(*this, sol, INT_VAR_SIZE_MIN(), INT_VAL_MED());
                 int_val_med(*this, sol);
             } break;
         }
     }
   
-    NQueens(bool share, NQueens &s) : Space(share, s){
+    NQueens(SHARE_PARAM NQueens &s) : Space(SHARE_ARG s), Trace::Depth(s){
         n = s.n;
-        sol.update(*this, share, s.sol);
+        sol.update(*this, SHARE_ARG s.sol);
     }
-    virtual Space* copy(bool share){
-        return new NQueens(share, *this);
+    virtual Space* copy(SHARE_VOID){
+        return new NQueens(SHARE_ARG *this);
     }
     void print(ostream& os) const {
         os << sol << std::endl;
     }
 };
 
-int main(int argc, char* argv[]){
-    NQueensOption opt("NQueens Problem", 6);
+// Compare countQueens with the number of solutions of NQueens for
+// every size up to opt.n; returns whether all counts agree. The models
+// are built and searched with the options of opt, except that all
+// solutions are enumerated without restarts, which would count some
+// of them again.
+bool checkCounts(const NQueensOption& opt, unsigned int threads, ostream& os) {
+    bool ok = true;
+    for (int m = 1; m <= opt.n; m ++) {
+        NQueensOption o("NQueens Problem", m);
+        o.messages(opt.messages());
+        o.search(opt.search());
+        o.branching(opt.branching());
+        o.restart(opt.restart());
+        o.seed(opt.seed());
+        o.decay(opt.decay());
+        Search::Options so = Solve::options(opt, false);
+        delete so.cutoff;
+        so.cutoff = NULL;
+        Search::Base<NQueens>* e = Solve::engine<NQueens, DFS>(new NQueens(o), so);
+        Solve::Outcome out = Solve::loop(*e, 0,
+            [](NQueens* t, const Search::Statistics&) {
+                delete t;
+                return true;
+            });
+        delete e;
+        unsigned long long cp = out.solutions;
+        unsigned long long bits = countQueens(m, threads);
+        os << m << " queens: " << cp << " (cp) " << bits << " (count)"
+             << (cp == bits ? "" : " MISMATCH") << endl;
+        ok = ok && cp == bits;
+    }
+    return ok;
+}
+
+// Count the solutions of opt.n queens with countQueens
+void printCount(const NQueensOption& opt, unsigned int threads, ostream& os) {
+    Support::Timer t;
+    t.start();
+    unsigned long long count = countQueens(opt.n, threads);
+    double ms = t.stop();
+    os << opt.n << " queens: " << count << " solutions" << endl
+       << "\truntime:      " << ms / 1000 << " (" << ms << " ms)" << endl;
+}
+
+void parseOptions(NQueensOption& opt, int& argc, char* argv[]) {
     opt.solutions(1);
     opt.search(NQueens::SEARCH_ONE);
-    opt.search(NQueens::SEARCH_ONE, "1");
-    opt.search(NQueens::SEARCH_TWO, "2");
+    opt.search(NQueens::SEARCH_ONE, "1", "branch with the -branching heuristic");
+    opt.search(NQueens::SEARCH_TWO, "2",
+               "split the smallest domain on its median, ignores -branching");
+    opt.model(NQueens::MODEL_CP);
+    opt.model(NQueens::MODEL_CP, "cp", "enumerate with the constraint model");
+    opt.model(NQueens::MODEL_COUNT, "count", "count all solutions with bit masks");
+    opt.model(NQueens::MODEL_CHECK, "check", "compare both counts for 1..n");
 
     opt.parse(argc, argv);
+}
 
-    Script::run<NQueens, DFS, NQueensOption>(opt);
+// Why opt.n cannot be solved, or NULL. countQueens keeps a row in the
+// bits of an unsigned long long.
+const char* sizeError(const NQueensOption& opt) {
+    if (opt.n < 1)
+        return "there must be at least one queen";
+    if (opt.n > 63 && opt.model() != NQueens::MODEL_CP)
+        return "counting supports at most 63 queens";
+    return NULL;
+}
+
+// Solve one service request
+bool serveNQueens(int argc, char* argv[], ostream& os) {
+    NQueensOption opt("NQueens Problem", 6);
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (const char* error = sizeError(opt))
+        throw Exception("nqueen", error);
+    if (opt.model() == NQueens::MODEL_COUNT)
+        printCount(opt, Service::threads(opt), os);
+    else if (opt.model() == NQueens::MODEL_CHECK)
+        (void) checkCounts(opt, Service::threads(opt), os);
+    else
+        return Service::solve<NQueens, DFS, NQueensOption>(opt, os);
+    return true;
+}
+
+// bench/bench.cpp includes the model with DRIVER_NO_MAIN defined.
+#ifndef DRIVER_NO_MAIN
+int main(int argc, char* argv[]){
+    NQueensOption opt("NQueens Problem", 6);
+    parseOptions(opt, argc, argv);
+
+    // Threads of the counting engine or of the service,
+    // 0 for one per core
+    unsigned int threads = Service::threads(opt);
+
+    if (opt.service()[0] != '\0')
+        return Service::serve(opt.service(), threads, serveNQueens);
+    else if (const char* error = sizeError(opt)) {
+        cerr << argv[0] << ": " << error << endl;
+        return 1;
+    } else if (opt.model() == NQueens::MODEL_COUNT)
+        printCount(opt, threads, cout);
+    else if (opt.model() == NQueens::MODEL_CHECK)
+        return checkCounts(opt, threads, cout) ? 0 : 1;
+    else if (opt.processes() > 0)
+        Distributed::run<NQueens, DFS, Solve::NoObjective>(opt, opt.processes());
+    else
+        Script::run<NQueens, DFS, NQueensOption>(opt);
 
     return 0;
 }
+#endif
 
 
-// How I "Compile":
-// Copy and paste the code to overwrite one of the example cpp file
-// under gecode-5.0.0/examples. Then make && make install.
+// How to compile, from the repository root:
+//   cmake -S . -B build && cmake --build build
+// See CMakeLists.txt for the LTO and PGO configurations.
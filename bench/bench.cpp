@@ -0,0 +1,351 @@
+// Benchmark harness for the Gecode models of this repository.
+//
+// Runs every model and search variant over a sweep of sizes with
+// warm-up and repeated trials, and writes one record per trial:
+//   bench -run all -sizes 6:12:2 -trials 5 -warmup 1 -out base.csv
+//   bench -format json -out base.json -run nqueen -sizes 10,20,30
+// Two result files written as CSV can be compared, flagging every
+// instance whose median runtime grew by more than the threshold:
+//   bench compare base.csv new.csv [threshold, default 0.10]
+#define DRIVER_NO_MAIN
+
+#include "../Brancher_N_Labeling/knight.cpp"
+#include "../Brancher_N_Labeling/nqueen.cpp"
+#include "../langford/langford.cpp"
+#include "../royalhunt/royal.cpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Gecode;
+using namespace std;
+
+
+class BenchOptions : public Options {
+protected:
+    Driver::StringValueOption _run;     // model to run, or all
+    Driver::StringValueOption _sizes;   // size sweep
+    Driver::UnsignedIntOption _k;       // occurrences for Langford
+    Driver::StringValueOption _data;    // royalhunt instances
+    Driver::UnsignedIntOption _trials;  // measured runs per instance
+    Driver::UnsignedIntOption _warmup;  // unmeasured runs per instance
+    Driver::StringValueOption _format;  // csv or json
+    Driver::StringValueOption _out;     // output file, stdout if empty
+public:
+    BenchOptions(const char* s)
+        : Options(s),
+          _run("run", "knight, nqueen, langford, royal or all", "all"),
+          _sizes("sizes", "sizes as first:last:step or a comma list", "6:8:2"),
+          _k("k", "occurrences of every number in Langford", 2),
+          _data("data", "comma separated royalhunt instances", ""),
+          _trials("trials", "measured runs per instance", 5),
+          _warmup("warmup", "unmeasured runs per instance", 1),
+          _format("format", "output format: csv or json", "csv"),
+          _out("out", "output file (default: stdout)", "") {
+        add(_run); add(_sizes); add(_k); add(_data);
+        add(_trials); add(_warmup); add(_format); add(_out);
+        heuristicOptions(*this);
+        branching(BRANCH_WARNSDORFF, "warnsdorff", "knight only, other models use size");
+    }
+    string run(void) const { return _run.value(); }
+    string sizes(void) const { return _sizes.value(); }
+    int k(void) const { return _k.value(); }
+    string data(void) const { return _data.value(); }
+    unsigned int trials(void) const { return _trials.value(); }
+    unsigned int warmup(void) const { return _warmup.value(); }
+    string format(void) const { return _format.value(); }
+    string out(void) const { return _out.value(); }
+};
+
+// Outcome of one measured run
+struct Record {
+    string model, variant, instance;
+    unsigned int trial;
+    double runtime;       // milliseconds, including model construction
+    unsigned long int solutions, nodes, failures, propagations, depth;
+    bool complete;        // false if the time limit was hit
+};
+
+// Split s at every occurrence of sep
+vector<string> tokens(const string& s, char sep) {
+    vector<string> result;
+    string token;
+    istringstream is(s);
+    while (getline(is, token, sep))
+        if (!token.empty())
+            result.push_back(token);
+    return result;
+}
+
+// Parse "first:last:step" or "a,b,c"
+vector<int> parseSizes(const string& s) {
+    vector<int> result;
+    vector<string> range = tokens(s, ':');
+    if (range.size() >= 2) {
+        int step = range.size() > 2 ? atoi(range[2].c_str()) : 1;
+        for (int i = atoi(range[0].c_str()); i <= atoi(range[1].c_str()); i += max(step, 1))
+            result.push_back(i);
+    } else {
+        vector<string> list = tokens(s, ',');
+        for (unsigned int i = 0; i < list.size(); i++)
+            result.push_back(atoi(list[i].c_str()));
+    }
+    return result;
+}
+
+// The models print which model and search they use while being
+// constructed; that output is dropped while benchmarking.
+class Mute {
+    streambuf* saved;
+    ostringstream sink;
+public:
+    Mute(void) : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~Mute(void) { cout.rdbuf(saved); }
+};
+
+// The options of the command line that the models take when being
+// built: the heuristic, and the seed and decay it may use
+void modelOptions(Options& o, const BenchOptions& bopt) {
+    o.branching(bopt.branching());
+    o.restart(bopt.restart());
+    o.seed(bopt.seed());
+    o.decay(bopt.decay());
+}
+
+// Construct the model from o and search it with engine E, with the
+// engine options of the command line as the drivers do.
+template<class Model, template<class> class Engine, class Opt>
+Record measure(const Opt& o, const BenchOptions& bopt) {
+    Record r;
+    Support::Timer t;
+    Search::Options so = Solve::options(bopt);
+
+    Mute mute;
+    t.start();
+    Search::Base<Model>* e = Solve::engine<Model,Engine>(new Model(o), so);
+    Solve::Outcome out = Solve::loop(*e, bopt.solutions(),
+        [](Model* s, const Search::Statistics&) {
+            delete s;
+            return true;
+        });
+    r.runtime = t.stop();
+    r.solutions = out.solutions;
+    r.nodes = out.stat.node;
+    r.failures = out.stat.fail;
+    r.propagations = out.stat.propagate;
+    r.depth = out.stat.depth;
+    r.complete = !out.stopped;
+    delete e;
+    delete so.stop;
+    return r;
+}
+
+// Run warm-up and measured trials of one instance and collect the records
+template<class Model, template<class> class Engine, class Opt>
+void trials(const Opt& o, const BenchOptions& bopt,
+            const string& model, const string& variant, const string& instance,
+            vector<Record>& records) {
+    for (unsigned int i = 0; i < bopt.warmup(); i++)
+        (void) measure<Model,Engine,Opt>(o, bopt);
+    for (unsigned int i = 0; i < bopt.trials(); i++) {
+        Record r = measure<Model,Engine,Opt>(o, bopt);
+        r.model = model;
+        r.variant = variant;
+        r.instance = instance;
+        r.trial = i;
+        records.push_back(r);
+        cerr << model << " " << variant << " " << instance
+             << " trial " << i << ": " << r.runtime << " ms" << endl;
+    }
+}
+
+void benchKnight(const BenchOptions& bopt, vector<Record>& records) {
+    vector<int> sizes = parseSizes(bopt.sizes());
+    for (unsigned int i = 0; i < sizes.size(); i++) {
+        KnightsOption o("Knights Move", sizes[i]);
+        modelOptions(o, bopt);
+        trials<Knights,DFS,KnightsOption>(o, bopt, "knight", "dfs",
+                                          to_string(sizes[i]), records);
+    }
+}
+
+void benchNQueens(const BenchOptions& bopt, vector<Record>& records) {
+    vector<int> sizes = parseSizes(bopt.sizes());
+    const int searches[] = {NQueens::SEARCH_ONE, NQueens::SEARCH_TWO};
+    for (unsigned int i = 0; i < sizes.size(); i++)
+        for (int s = 0; s < 2; s++) {
+            NQueensOption o("NQueens Problem", sizes[i]);
+            modelOptions(o, bopt);
+            o.search(searches[s]);
+            trials<NQueens,DFS,NQueensOption>(o, bopt, "nqueen",
+                                              "search" + to_string(s+1),
+                                              to_string(sizes[i]), records);
+        }
+}
+
+void benchLangford(const BenchOptions& bopt, vector<Record>& records) {
+    vector<int> sizes = parseSizes(bopt.sizes());
+    // Only the channeling models distinguish between the searches
+    const int variants[][2] = {
+        {Langford::MODEL_ONE, Langford::SEARCH_ONE},
+        {Langford::MODEL_TWO, Langford::SEARCH_ONE},
+        {Langford::MODEL_CHANNEL, Langford::SEARCH_ONE},
+        {Langford::MODEL_CHANNEL, Langford::SEARCH_TWO},
+        {Langford::MODEL_CHANNEL, Langford::SEARCH_THREE},
+        {Langford::MODEL_SYM, Langford::SEARCH_ONE},
+        {Langford::MODEL_SYM, Langford::SEARCH_TWO},
+        {Langford::MODEL_SYM, Langford::SEARCH_THREE},
+    };
+    for (unsigned int i = 0; i < sizes.size(); i++)
+        for (int v = 0; v < 8; v++) {
+            LangfordOptions o("Langford", sizes[i], bopt.k());
+            modelOptions(o, bopt);
+            o.model(variants[v][0]);
+            o.search(variants[v][1]);
+            string variant = "model" + to_string(variants[v][0] + 1) +
+                "-search" + to_string(variants[v][1] - Langford::SEARCH_ONE + 1);
+            trials<Langford,DFS,LangfordOptions>(o, bopt, "langford", variant,
+                                                 to_string(sizes[i]) + "," + to_string(bopt.k()),
+                                                 records);
+        }
+}
+
+void benchRoyal(const BenchOptions& bopt, vector<Record>& records) {
+    vector<string> files = tokens(bopt.data(), ',');
+    for (unsigned int i = 0; i < files.size(); i++) {
+        royalhuntOptions o("Royal Hunt");
+        o.ipl(IPL_DOM);
+        modelOptions(o, bopt);
+        o.filename = const_cast<char*>(files[i].c_str());
+        trials<royalhunt,BAB,royalhuntOptions>(o, bopt, "royal", "bab",
+                                               files[i], records);
+    }
+}
+
+void writeCsv(ostream& os, const vector<Record>& records) {
+    os << "model,variant,instance,trial,runtime_ms,solutions,nodes,"
+       << "failures,propagations,peak_depth,complete" << endl;
+    for (unsigned int i = 0; i < records.size(); i++) {
+        const Record& r = records[i];
+        os << r.model << "," << r.variant << ",\"" << r.instance << "\","
+           << r.trial << "," << r.runtime << "," << r.solutions << ","
+           << r.nodes << "," << r.failures << "," << r.propagations << ","
+           << r.depth << "," << (r.complete ? 1 : 0) << endl;
+    }
+}
+
+void writeJson(ostream& os, const vector<Record>& records) {
+    os << "[" << endl;
+    for (unsigned int i = 0; i < records.size(); i++) {
+        const Record& r = records[i];
+        os << "  {\"model\": \"" << r.model << "\", \"variant\": \"" << r.variant
+           << "\", \"instance\": \"" << r.instance << "\", \"trial\": " << r.trial
+           << ", \"runtime_ms\": " << r.runtime << ", \"solutions\": " << r.solutions
+           << ", \"nodes\": " << r.nodes << ", \"failures\": " << r.failures
+           << ", \"propagations\": " << r.propagations << ", \"peak_depth\": " << r.depth
+           << ", \"complete\": " << (r.complete ? "true" : "false") << "}"
+           << (i+1 < records.size() ? "," : "") << endl;
+    }
+    os << "]" << endl;
+}
+
+// Per instance: median runtime and the node count of the first trial
+struct Summary {
+    vector<double> runtimes;
+    unsigned long int nodes;
+};
+
+// Read a CSV file written by writeCsv, keyed by model/variant/instance
+map<string,Summary> readCsv(const char* filename) {
+    map<string,Summary> result;
+    ifstream is(filename);
+    if (!is.is_open()) {
+        cerr << "cannot open " << filename << endl;
+        exit(2);
+    }
+    string line;
+    getline(is, line); // header
+    while (getline(is, line)) {
+        // The instance is quoted as it may contain a comma
+        size_t q0 = line.find('"'), q1 = line.find('"', q0+1);
+        if (q0 == string::npos || q1 == string::npos) continue;
+        vector<string> head = tokens(line.substr(0, q0), ',');
+        vector<string> tail = tokens(line.substr(q1+1), ',');
+        if (head.size() < 2 || tail.size() < 4) continue;
+        string key = head[0] + " " + head[1] + " " + line.substr(q0+1, q1-q0-1);
+        Summary& s = result[key];
+        if (s.runtimes.empty())
+            s.nodes = strtoul(tail[3].c_str(), NULL, 10);
+        s.runtimes.push_back(atof(tail[1].c_str()));
+    }
+    return result;
+}
+
+double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : (v[m-1] + v[m]) / 2;
+}
+
+// Compare two result files; returns the number of regressions
+int compare(const char* base, const char* next, double threshold) {
+    map<string,Summary> b = readCsv(base), n = readCsv(next);
+    int regressions = 0;
+    cout << "instance\tbase_ms\tnew_ms\tchange" << endl;
+    for (map<string,Summary>::iterator i = n.begin(); i != n.end(); ++i) {
+        map<string,Summary>::iterator j = b.find(i->first);
+        if (j == b.end()) continue;
+        double mb = median(j->second.runtimes), mn = median(i->second.runtimes);
+        double change = mb > 0 ? (mn - mb) / mb : 0;
+        cout << i->first << "\t" << mb << "\t" << mn << "\t"
+             << (change >= 0 ? "+" : "") << 100*change << "%";
+        if (change > threshold) {
+            cout << "\tREGRESSION";
+            regressions++;
+        }
+        // A different tree means the search itself has changed
+        if (j->second.nodes != i->second.nodes)
+            cout << "\tnodes " << j->second.nodes << " -> " << i->second.nodes;
+        cout << endl;
+    }
+    cout << regressions << " regression(s)" << endl;
+    return regressions;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc >= 4 && string(argv[1]) == "compare")
+        return compare(argv[2], argv[3], argc > 4 ? atof(argv[4]) : 0.10) > 0 ? 1 : 0;
+
+    BenchOptions opt("Benchmark");
+    opt.solutions(0);
+    opt.time(60000);
+    opt.parse(argc, argv);
+
+    vector<Record> records;
+    string model = opt.run();
+    if (model == "knight" || model == "all")
+        benchKnight(opt, records);
+    if (model == "nqueen" || model == "all")
+        benchNQueens(opt, records);
+    if (model == "langford" || model == "all")
+        benchLangford(opt, records);
+    if (model == "royal" || model == "all")
+        benchRoyal(opt, records);
+
+    ofstream file;
+    if (!opt.out().empty())
+        file.open(opt.out().c_str());
+    ostream& os = opt.out().empty() ? cout : file;
+    if (opt.format() == "json")
+        writeJson(os, records);
+    else
+        writeCsv(os, records);
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#!/bin/bash
+# Check that the native suitor and elephant2 drivers find the same
+# optima as their MiniZinc models on every shipped instance, and print
+# one tab separated row per instance:
+#   model  instance  native  minizinc  verdict
+#
+# Usage: bench/check_optima.sh [bindir] [time limit in ms]
+# The binaries suitor and elephant2 are looked up in bindir. The models
+# are run with minizinc --solver gecode, or with mzn-gecode when
+# minizinc is not installed. An objective is only compared once both
+# sides have proved it optimal; otherwise the verdict is unproven.
+# Exits with 1 if some optimum differs, and with 2 if neither minizinc
+# nor mzn-gecode is installed.
+
+BIN=${1:-.}
+LIMIT=${2:-60000}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+if command -v minizinc > /dev/null; then
+    FLATZINC="minizinc --solver gecode -a --time-limit $LIMIT"
+elif command -v mzn-gecode > /dev/null; then
+    FLATZINC="mzn-gecode -a"
+else
+    echo "minizinc not found" >&2
+    exit 2
+fi
+
+TMP=$(mktemp)
+trap 'rm -f "$TMP"' EXIT
+
+# The optimum proved by the native driver, "-" if there is none: the
+# summary of -anytime marks the best objective with (optimal), and
+# "Search complete" without incumbents means unsatisfiable.
+native() {
+    "$1" -mode stat -time "$LIMIT" -anytime "$TMP" "$2" 2>&1 |
+    awk '$1 == "best:" && $NF == "(optimal)" { o = $(NF-1) }
+         $0 == "Search complete" { c = 1 }
+         END { if (o != "") print o; else if (c) print "unsat"; else print "-" }'
+}
+
+# The optimum proved by minizinc: the objective of the last solution
+# printed, if the search ended with ==========.
+flatzinc() {
+    local name=$1
+    shift
+    timeout $(( LIMIT / 1000 + 30 )) $FLATZINC "$@" 2>&1 |
+    awk -v n="$name" -F'[ =;]+' '
+        $1 == n { o = $2 }
+        /^==========/ { done = 1 }
+        /^=====UNSATISFIABLE=====/ { unsat = 1 }
+        END { if (unsat) print "unsat"; else if (done && o != "") print o; else print "-" }'
+}
+
+differ=0
+check() {
+    local model=$1 instance=$2 mine=$3 theirs=$4 verdict
+    if [ "$mine" = "-" ] || [ "$theirs" = "-" ]; then
+        verdict=unproven
+    elif [ "$mine" = "$theirs" ]; then
+        verdict=equal
+    else
+        verdict=DIFFER
+        differ=1
+    fi
+    printf "%s\t%s\t%s\t%s\t%s\n" "$model" "$instance" "$mine" "$theirs" "$verdict"
+}
+
+printf "model\tinstance\tnative\tminizinc\tverdict\n"
+for f in "$ROOT"/suitor_schedule/data/*.dzn; do
+    check suitor "$(basename "$f" .dzn)" \
+        "$(native "$BIN/suitor" "$f")" \
+        "$(flatzinc obj "$ROOT/suitor_schedule/suitor_schedule.mzn" "$f")"
+done
+for f in "$ROOT"/elephant2/data/*.dzn; do
+    check elephant2 "$(basename "$f" .dzn)" \
+        "$(native "$BIN/elephant2" "$f")" \
+        "$(flatzinc end "$ROOT/elephant2/elephant2.mzn" "$f")"
+done
+exit $differ
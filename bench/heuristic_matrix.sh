@@ -0,0 +1,44 @@
+#!/bin/bash
+# Run every model under every branching heuristic and print one
+# tab separated row per run:
+#   model  heuristic  instance  runtime(ms)  nodes  failures
+#
+# Usage: bench/heuristic_matrix.sh [bindir] [time limit in ms]
+# The binaries langford, royal, knight and nqueen are looked up in bindir.
+# royal reads its plain text instance format; the instances are taken
+# from $ROYAL_DATA (a glob) and skipped when it is not set.
+
+BIN=${1:-.}
+LIMIT=${2:-60000}
+HEURISTICS="size afc activity chb med"
+
+# Run one instance and reduce Gecode's statistics to a row.
+run() {
+    local model=$1 heuristic=$2 instance=$3
+    shift 3
+    "$BIN/$model" -mode stat -time "$LIMIT" -branching "$heuristic" "$@" 2>&1 |
+    awk -v m="$model" -v h="$heuristic" -v i="$instance" '
+        $1 == "runtime:"  { ms = $3; gsub(/[()]/, "", ms) }
+        $1 == "nodes:"    { nodes = $2 }
+        $1 == "failures:" { fails = $2 }
+        END { printf "%s\t%s\t%s\t%s\t%s\t%s\n", m, h, i, ms, nodes, fails }'
+}
+
+printf "model\theuristic\tinstance\truntime_ms\tnodes\tfailures\n"
+for h in $HEURISTICS; do
+    for n in 6 8; do
+        run knight "$h" "$n" "$n"
+    done
+    for (( n=10; n<=200; n=n+10 )); do
+        run nqueen "$h" "$n" -search 1 "$n"
+    done
+    for n in 7 8 11 12; do
+        run langford "$h" "L(2,$n)" -model 3 -search 2 "$n" 2
+    done
+    for n in 9 10 17 18; do
+        run langford "$h" "L(3,$n)" -model 3 -search 2 "$n" 3
+    done
+    for f in $ROYAL_DATA; do
+        [ -f "$f" ] && run royal "$h" "$(basename "$f")" "$f"
+    done
+done
@@ -0,0 +1,107 @@
+// Microbenchmark of the knight Move propagators.
+//
+// For every specialised board size, a chain of Move propagators over
+// the n*n tour variables is posted once with the runtime Move and once
+// with MoveN<n>. Both variants then propagate the same sequence of
+// random assignments, and the propagation throughput is reported with
+// the speedup of MoveN over Move. Only status() is timed:
+//   move_micro [repetitions, default 2000]
+#define DRIVER_NO_MAIN
+
+#include "../Brancher_N_Labeling/knight.cpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace Gecode;
+using namespace std;
+
+
+// Tour variables linked by Move only
+class MoveChain : public Space {
+public:
+    IntVarArray x;
+
+    MoveChain(int n, bool specialised) : x(*this, n*n, 1, n*n) {
+        for (int i = 0; i < n*n-1; i ++) {
+            Int::IntView y0(x[i]), y1(x[i+1]);
+            ExecStatus es = specialised ? postMove(*this,y0,y1,n)
+                                        : Move::post(*this,y0,y1,n);
+            if (es != ES_OK)
+                fail();
+        }
+    }
+    MoveChain(SHARE_PARAM MoveChain& s) : Space(SHARE_ARG s) {
+        x.update(*this, SHARE_ARG s.x);
+    }
+    virtual Space* copy(SHARE_VOID) {
+        return new MoveChain(SHARE_ARG *this);
+    }
+};
+
+// Clones propagated per timed batch, bounding the memory held
+const int BATCH = 100;
+
+// Propagate reps random assignments on clones of a chain for an
+// n x n board; returns the propagations and the milliseconds spent in
+// status() alone. Cloning, posting the assignments and deleting the
+// clones happen outside of the timer.
+void measure(int n, bool specialised, int reps,
+             unsigned long int& propagations, double& ms) {
+    MoveChain* root = new MoveChain(n, specialised);
+    (void) root->status();
+    srand(n);
+    propagations = 0;
+    ms = 0;
+    vector<MoveChain*> batch;
+    for (int done = 0; done < reps; done += BATCH) {
+        for (int r = done; r < min(reps, done + BATCH); r ++) {
+            MoveChain* c = static_cast<MoveChain*>(root->clone());
+            // Assign a random step to a random value of its domain
+            int i = rand() % (n*n);
+            int k = rand() % c->x[i].size();
+            IntVarValues v(c->x[i]);
+            while (k-- > 0)
+                ++v;
+            rel(*c, c->x[i], IRT_EQ, v.val());
+            batch.push_back(c);
+        }
+        vector<StatusStatistics> stat(batch.size());
+        Support::Timer t;
+        t.start();
+        for (size_t b = 0; b < batch.size(); b ++)
+            (void) batch[b]->status(stat[b]);
+        ms += t.stop();
+        for (size_t b = 0; b < batch.size(); b ++) {
+            propagations += stat[b].propagate;
+            delete batch[b];
+        }
+        batch.clear();
+    }
+    delete root;
+}
+
+int main(int argc, char* argv[]) {
+    int reps = argc > 1 ? atoi(argv[1]) : 2000;
+    const int sizes[] = {6, 8, 10, 12, 16};
+    cout << "n\tvariant\tpropagations\tms\tns/propagate\tspeedup" << endl;
+    for (int s = 0; s < 5; s ++) {
+        // The baseline Move first, then MoveN<n> relative to it
+        double base = 0;
+        for (int specialised = 0; specialised < 2; specialised ++) {
+            unsigned long int propagations;
+            double ms;
+            measure(sizes[s], specialised, reps, propagations, ms);
+            double ns = propagations > 0 ? 1e6 * ms / propagations : 0;
+            if (!specialised)
+                base = ns;
+            cout << sizes[s] << "\t" << (specialised ? "MoveN" : "Move") << "\t"
+                 << propagations << "\t" << fixed << setprecision(2) << ms << "\t"
+                 << ns << "\t" << (ns > 0 ? base / ns : 0) << endl;
+        }
+    }
+    return 0;
+}
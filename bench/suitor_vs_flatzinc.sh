@@ -0,0 +1,47 @@
+#!/bin/bash
+# Compare the native suitor_schedule driver with the FlatZinc route on
+# every shipped instance and print one tab separated row per run:
+#   route  instance  wall(ms)  objective
+#
+# Usage: bench/suitor_vs_flatzinc.sh [bindir] [time limit in ms]
+# The binary suitor is looked up in bindir. The FlatZinc route runs
+# suitor_schedule.mzn with minizinc --solver gecode, or with mzn-gecode
+# when minizinc is not installed; the wall time includes flattening.
+
+BIN=${1:-.}
+LIMIT=${2:-60000}
+DIR=$(cd "$(dirname "$0")/../suitor_schedule" && pwd)
+
+if command -v minizinc > /dev/null; then
+    FLATZINC="minizinc --solver gecode --time-limit $LIMIT"
+elif command -v mzn-gecode > /dev/null; then
+    FLATZINC="mzn-gecode -a"
+else
+    FLATZINC=""
+    echo "minizinc not found, running the native driver only" >&2
+fi
+
+now() {
+    date +%s%N
+}
+
+# Run one route and reduce its output to a row: the objective is the
+# last one printed, that of the best solution found.
+run() {
+    local route=$1 instance=$2
+    shift 2
+    local t0=$(now)
+    local obj=$("$@" 2>&1 | awk -F'[ =;]+' '$1 == "obj" { o = $2 } END { print o }')
+    local ms=$(( ($(now) - t0) / 1000000 ))
+    printf "%s\t%s\t%s\t%s\n" "$route" "$instance" "$ms" "${obj:--}"
+}
+
+printf "route\tinstance\twall_ms\tobjective\n"
+for stage in A B C; do
+    for f in "$DIR"/data/suitor_schedule${stage}_*.dzn; do
+        i=$(basename "$f" .dzn)
+        run native "$i" "$BIN/suitor" -time "$LIMIT" "$f"
+        [ -n "$FLATZINC" ] &&
+            run flatzinc "$i" timeout $(( LIMIT / 1000 + 30 )) $FLATZINC "$DIR/suitor_schedule.mzn" "$f"
+    done
+done
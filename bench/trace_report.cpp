@@ -0,0 +1,99 @@
+// Report on a search trace, see common/trace.hh:
+//   DISCOPT_TRACE=knight.trace ./knight -c_d 1 8
+//   trace_report knight.trace [top, default 20]
+// Prints the number of commits and failures at every depth and the
+// top variables by the failures that followed a commit on them. A
+// failure is charged to the last commit of the same thread, which is
+// the commit whose propagation failed.
+#include "../common/trace.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Commits and failures of a depth or of a variable
+struct Count {
+    unsigned long commits, failures;
+    Count(void) : commits(0), failures(0) {}
+};
+
+bool moreFailures(const pair<int,Count>& a, const pair<int,Count>& b) {
+    if (a.second.failures != b.second.failures)
+        return a.second.failures > b.second.failures;
+    return a.second.commits > b.second.commits;
+}
+
+// A bar of at most 50 characters for v out of max
+string bar(unsigned long v, unsigned long max) {
+    return string(max > 0 ? (50 * v + max - 1) / max : 0, '#');
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " trace [top]" << endl;
+        return 1;
+    }
+    unsigned int top = argc > 2 ? atoi(argv[2]) : 20;
+    ifstream in(argv[1], ios::binary);
+    char magic[sizeof(Trace::MAGIC)];
+    if (!in.read(magic, sizeof(magic)) ||
+        !equal(magic, magic + sizeof(magic), Trace::MAGIC)) {
+        cerr << argv[1] << " is not a trace" << endl;
+        return 1;
+    }
+
+    map<unsigned int, Count> depths;
+    map<int, Count> vars;
+    map<unsigned int, int> last; // last variable committed per thread
+    unsigned long commits = 0, failures = 0, unattributed = 0;
+    Trace::Event e;
+    while (in.read(reinterpret_cast<char*>(&e), sizeof(e))) {
+        if (e.type == Trace::COMMIT) {
+            commits++;
+            depths[e.depth].commits++;
+            vars[e.var].commits++;
+            last[e.thread] = e.var;
+        } else if (e.type == Trace::FAIL) {
+            failures++;
+            depths[e.depth].failures++;
+            map<unsigned int, int>::iterator l = last.find(e.thread);
+            if (l != last.end())
+                vars[l->second].failures++;
+            else
+                unattributed++;
+        }
+    }
+
+    cout << "commits:  " << commits << endl
+         << "failures: " << failures << endl
+         << "threads:  " << last.size() << endl << endl;
+
+    unsigned long most = 0;
+    for (map<unsigned int, Count>::iterator i = depths.begin(); i != depths.end(); i++)
+        most = max(most, i->second.failures);
+    cout << "depth\tcommits\tfailures" << endl;
+    for (map<unsigned int, Count>::iterator i = depths.begin(); i != depths.end(); i++)
+        cout << i->first << "\t" << i->second.commits << "\t" << i->second.failures
+             << "\t" << bar(i->second.failures, most) << endl;
+    cout << endl;
+
+    vector<pair<int,Count> > hot(vars.begin(), vars.end());
+    sort(hot.begin(), hot.end(), moreFailures);
+    cout << "variable\tcommits\tfailures\tfailures/commit" << endl;
+    for (unsigned int i = 0; i < hot.size() && i < top; i++)
+        cout << hot[i].first << "\t" << hot[i].second.commits << "\t"
+             << hot[i].second.failures << "\t" << fixed << setprecision(2)
+             << (hot[i].second.commits > 0 ?
+                 double(hot[i].second.failures) / hot[i].second.commits : 0) << endl;
+    if (unattributed > 0)
+        cout << unattributed << " failures before the first commit" << endl;
+    return 0;
+}
@@ -0,0 +1,165 @@
+#ifndef __ANYTIME_HH__
+#define __ANYTIME_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/search.hh>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "solve.hh"
+
+using namespace Gecode;
+
+// Anytime quality of optimisation runs, for -anytime file.csv.
+//
+// Every incumbent is recorded with the time and nodes it took, and the
+// run is summed up by its primal integral: the integral over time of
+// the primal gap between the incumbent and the best known objective,
+// 1 before the first incumbent. The best known objective is the
+// optimum if search completed and the last incumbent otherwise, so
+// runs of the same instance are only comparable when they complete.
+// The smaller the integral (in seconds), the sooner good solutions
+// were found; divided by the runtime it is the average gap.
+//
+// The bound is the best objective the root still allows after
+// propagation, see Solve::Objective::limit.
+
+namespace Anytime {
+
+// An incumbent
+struct Point {
+    double ms;
+    unsigned long int nodes, failures;
+    int value;
+};
+
+// Primal gap between objectives a and b, in [0, 1]
+inline double gap(int a, int b) {
+    if (a == b)
+        return 0;
+    if ((a < 0 && b > 0) || (a > 0 && b < 0))
+        return 1;
+    double x = std::abs(static_cast<double>(a)), y = std::abs(static_cast<double>(b));
+    return std::abs(x - y) / std::max(x, y);
+}
+
+class Log {
+protected:
+    Support::Timer t;
+    std::vector<Point> points;
+    bool bounded;
+    int bound;
+    double end;
+    bool complete;
+public:
+    Log(void) : bounded(false), bound(0), end(0), complete(false) {
+        t.start();
+    }
+    // The best objective possible
+    void limit(int v) {
+        bounded = true;
+        bound = v;
+    }
+    // An incumbent of objective v found after the given search effort
+    void add(unsigned long int nodes, unsigned long int failures, int v) {
+        Point p;
+        p.ms = t.stop();
+        p.nodes = nodes;
+        p.failures = failures;
+        p.value = v;
+        points.push_back(p);
+    }
+    // Search has ended, proving the last incumbent optimal if c
+    void finish(bool c) {
+        end = t.stop();
+        complete = c;
+    }
+    // Integral of the primal gap over the run, in seconds
+    double primalIntegral(void) const {
+        if (points.empty())
+            return end / 1000;
+        int best = points.back().value;
+        double sum = points[0].ms;
+        for (size_t i = 0; i < points.size(); i++) {
+            double next = i + 1 < points.size() ? points[i+1].ms : end;
+            sum += gap(points[i].value, best) * (next - points[i].ms);
+        }
+        return sum / 1000;
+    }
+    // Write the incumbents as CSV; false if the file cannot be written
+    bool write(const char* filename) const {
+        std::ofstream os(filename);
+        os << "time_ms,nodes,failures,objective,bound,gap" << std::endl;
+        for (size_t i = 0; i < points.size(); i++) {
+            const Point& p = points[i];
+            os << p.ms << "," << p.nodes << "," << p.failures << "," << p.value << ",";
+            if (bounded)
+                os << bound << "," << gap(p.value, bound);
+            else
+                os << ",";
+            os << std::endl;
+        }
+        return static_cast<bool>(os);
+    }
+    void print(std::ostream& os) const {
+        os << "Anytime" << std::endl
+           << "\tincumbents:   " << points.size() << std::endl;
+        if (!points.empty())
+            os << "\tfirst:        " << points.front().ms << " ms" << std::endl
+               << "\tbest:         " << points.back().ms << " ms, objective "
+               << points.back().value << (complete ? " (optimal)" : "") << std::endl;
+        if (bounded)
+            os << "\tbound:        " << bound << std::endl;
+        if (bounded && !points.empty())
+            os << "\troot gap:     " << gap(points.back().value, bound) << std::endl;
+        os << "\tprimal integral: " << primalIntegral() << " s" << std::endl;
+    }
+    // Print the summary and write filename
+    void report(const char* filename) const {
+        std::cout << std::endl;
+        print(std::cout);
+        if (!write(filename))
+            std::cerr << "cannot write " << filename << std::endl;
+    }
+};
+
+// Search the model built from opt with BAB, restart-based if requested,
+// printing the solutions and statistics like Script::run, and write
+// the incumbents to filename. Objective is one of solve.hh.
+template<class Model, class Objective, class Opt>
+void run(const Opt& opt, const char* filename) {
+    Log log;
+    Support::Timer t;
+    t.start();
+    Search::Options so = Solve::options(opt);
+    Model* root = new Model(opt);
+    int v;
+    if (root->status() != SS_FAILED && Objective::limit(*root, v))
+        log.limit(v);
+    Search::Base<Model>* e = Solve::engine<Model,BAB>(root, so);
+    bool print = opt.mode() != SM_STAT;
+    Solve::Outcome o = Solve::loop(*e, 0,
+        [&](Model* s, const Search::Statistics& stat) {
+            if (Objective::value(*s, v))
+                log.add(stat.node, stat.fail, v);
+            if (print)
+                s->print(std::cout);
+            delete s;
+            return true;
+        });
+    log.finish(!o.stopped);
+    std::cout << std::endl
+              << (o.stopped ? "Search stopped" : "Search complete") << std::endl;
+    Solve::statistics(std::cout, t.stop(), o.solutions, o.stat);
+    delete e;
+    delete so.stop;
+    log.report(filename);
+}
+
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef __BRANCHING_HH__
+#define __BRANCHING_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/int.hh>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "int_val_med.hh"
+#include "trace.hh"
+
+using namespace Gecode;
+
+// Variable selection heuristics shared by all models,
+// selected with the -branching option.
+enum {
+    BRANCH_SIZE,     // smallest domain first
+    BRANCH_AFC,      // largest accumulated failure count / domain size
+    BRANCH_ACTIVITY, // largest activity / domain size
+    BRANCH_CHB,      // largest conflict-history score / domain size
+    BRANCH_MED,      // smallest domain first, split on the median
+};
+
+// Register the heuristics as values of the -branching option.
+template<class Opt>
+void heuristicOptions(Opt& opt) {
+    opt.branching(BRANCH_SIZE);
+    opt.branching(BRANCH_SIZE, "size", "smallest domain first");
+    opt.branching(BRANCH_AFC, "afc", "accumulated failure count over size");
+    opt.branching(BRANCH_ACTIVITY, "activity", "activity over size");
+    opt.branching(BRANCH_CHB, "chb", "conflict-history score over size");
+    opt.branching(BRANCH_MED, "med", "smallest domain, median value (int_val_med)");
+}
+
+// Options shared by the drivers: the heuristics above and
+//   -processes n    distributed search, see distributed.hh
+//   -service where  serve requests, see service.hh
+//   -anytime file   incumbents of optimisation runs, see anytime.hh
+// -anytime is only offered by drivers of optimisation models. Only one
+// of -processes, -service and -anytime may be given.
+//
+// Options::parse ends the process on -help, on a missing or unknown
+// value and on invalid combinations, which a service must not do. The
+// options of a request, see request(), are checked first and errors
+// throw std::invalid_argument instead.
+class DriverOptions : public Options {
+protected:
+    Driver::UnsignedIntOption _processes;
+    Driver::StringValueOption _service;
+    Driver::StringValueOption _anytime;
+    bool _request;
+    std::ostream* _messages;
+    // Values registered with model(), search() and branching()
+    std::map<std::string, std::vector<std::string> > _values;
+    // Options of the drivers that requests may give
+    std::map<std::string, int> _allowed;
+    // Options given on the command line or in the request
+    std::set<std::string> _given;
+
+    // Kinds of the options a request may give
+    enum Kind { NAMED, NUMBER, UNSIGNED, FLAG };
+    // Let requests give the option o of a driver
+    void allow(const char* o, Kind k) {
+        _allowed[o] = k;
+    }
+    Kind kind(const std::string& o, bool& known) const {
+        static const char* named[] = {
+            "model", "symmetry", "propagation", "branching", "search",
+            "mode", "restart", "ipl", NULL };
+        static const char* numbers[] = {
+            "decay", "step", "threads", "restart-base", "restart-scale",
+            "relax", NULL };
+        static const char* counts[] = {
+            "seed", "solutions", "c-d", "a-d", "d-l", "node", "fail", "time",
+            "assets", "slice", "nogoods-limit", "samples", "iterations", NULL };
+        static const char* flags[] = {
+            "nogoods", "interrupt", "print-last", NULL };
+        known = true;
+        for (int i = 0; named[i] != NULL; i++)
+            if (o == named[i]) return NAMED;
+        for (int i = 0; numbers[i] != NULL; i++)
+            if (o == numbers[i]) return NUMBER;
+        for (int i = 0; counts[i] != NULL; i++)
+            if (o == counts[i]) return UNSIGNED;
+        for (int i = 0; flags[i] != NULL; i++)
+            if (o == flags[i]) return FLAG;
+        std::map<std::string, int>::const_iterator a = _allowed.find(o);
+        if (a != _allowed.end())
+            return static_cast<Kind>(a->second);
+        known = false;
+        return FLAG;
+    }
+    // Whether v is one of the values of the named option o
+    bool named(const std::string& o, const std::string& v) const {
+        static const char* mode[] = { "solution", "time", "stat", NULL };
+        static const char* restart[] = {
+            "none", "constant", "linear", "luby", "geometric", NULL };
+        static const char* ipl[] = {
+            "def", "val", "bnd", "dom", "basic", "advanced", NULL };
+        if (o == "ipl") {
+            // A comma separated list
+            std::string w;
+            for (size_t i = 0; i <= v.size(); i++)
+                if (i == v.size() || v[i] == ',') {
+                    bool found = false;
+                    for (int k = 0; ipl[k] != NULL; k++)
+                        found = found || w == ipl[k];
+                    if (!found) return false;
+                    w.clear();
+                } else {
+                    w += v[i];
+                }
+            return true;
+        }
+        const char** fixed = o == "mode" ? mode : o == "restart" ? restart : NULL;
+        if (fixed != NULL) {
+            for (int k = 0; fixed[k] != NULL; k++)
+                if (v == fixed[k]) return true;
+            return false;
+        }
+        std::map<std::string, std::vector<std::string> >::const_iterator i =
+            _values.find(o);
+        return i != _values.end() &&
+            std::find(i->second.begin(), i->second.end(), v) != i->second.end();
+    }
+    // An option rather than an operand such as a negative size
+    static bool option(const char* a) {
+        return a[0] == '-' && a[1] != '\0' &&
+            !(a[1] >= '0' && a[1] <= '9');
+    }
+    // The name of option a without dashes, with - for _
+    static std::string optionName(const char* a) {
+        std::string o(a + (a[1] == '-' ? 2 : 1));
+        std::replace(o.begin(), o.end(), '_', '-');
+        return o;
+    }
+    static void invalid(const std::string& message) {
+        throw std::invalid_argument(message);
+    }
+    // Check the options of a request as Options::parse would take them
+    void check(int argc, char* argv[]) const {
+        for (int i = 1; i < argc; i++) {
+            if (!option(argv[i]))
+                continue;
+            std::string o = optionName(argv[i]);
+            bool known;
+            Kind k = kind(o, known);
+            if (!known)
+                invalid("-" + o + " is not available in requests");
+            if (k == FLAG) {
+                if (i + 1 < argc && (!std::strcmp(argv[i+1], "true") ||
+                                     !std::strcmp(argv[i+1], "false") ||
+                                     !std::strcmp(argv[i+1], "1") ||
+                                     !std::strcmp(argv[i+1], "0")))
+                    i++;
+                continue;
+            }
+            if (i + 1 == argc)
+                invalid("-" + o + " needs a value");
+            const char* v = argv[++i];
+            char* rest = NULL;
+            switch (k) {
+                case NAMED:
+                    if (!named(o, v))
+                        invalid("-" + o + ": unknown value " + v);
+                    break;
+                case NUMBER:
+                    (void) std::strtod(v, &rest);
+                    if (rest == v || *rest != '\0')
+                        invalid("-" + o + ": " + v + " is not a number");
+                    break;
+                default:
+                    (void) std::strtoul(v, &rest, 10);
+                    if (!(v[0] >= '0' && v[0] <= '9') || *rest != '\0')
+                        invalid("-" + o + ": " + v + " is not a count");
+            }
+        }
+    }
+public:
+    DriverOptions(const char* s, bool optimisation = false)
+        : Options(s),
+          _processes("processes", "worker processes for distributed search", 0),
+          _service("service", "serve requests from - (stdin) or a Unix socket", ""),
+          _anytime("anytime", "write the incumbents and their quality to a CSV file", ""),
+          _request(false), _messages(&std::cout) {
+        add(_processes);
+        add(_service);
+        if (optimisation)
+            add(_anytime);
+        heuristicOptions(*this);
+    }
+    // Values of the string options, recorded for the checks of requests
+    using Options::model;
+    void model(int v, const char* o, const char* h = NULL) {
+        Options::model(v, o, h);
+        _values["model"].push_back(o);
+    }
+    using Options::search;
+    void search(int v, const char* o, const char* h = NULL) {
+        Options::search(v, o, h);
+        _values["search"].push_back(o);
+    }
+    using Options::branching;
+    void branching(int v, const char* o, const char* h = NULL) {
+        Options::branching(v, o, h);
+        _values["branching"].push_back(o);
+    }
+    // The options of a service request, whose messages go to os
+    void request(std::ostream& os) {
+        _request = true;
+        _messages = &os;
+    }
+    bool request(void) const {
+        return _request;
+    }
+    // Where the models write what they report while being built
+    std::ostream& messages(void) const {
+        return *_messages;
+    }
+    void messages(std::ostream& os) {
+        _messages = &os;
+    }
+    unsigned int processes(void) const {
+        return _processes.value();
+    }
+    const char* service(void) const {
+        return _service.value();
+    }
+    const char* anytime(void) const {
+        return _anytime.value();
+    }
+    // Ends the process if both options given by name are set, as
+    // every driver runs only one of these modes
+    void exclusive(bool x, const char* a, bool y, const char* b) const {
+        if (x && y) {
+            std::cerr << name() << ": -" << a << " cannot be used with -" << b << std::endl;
+            exit(1);
+        }
+    }
+    // Whether option o, such as "solutions", was given
+    bool given(const char* o) const {
+        return _given.count(o) > 0;
+    }
+    void parse(int& argc, char* argv[]) {
+        if (_request)
+            check(argc, argv);
+        for (int i = 1; i < argc; i++)
+            if (option(argv[i]))
+                _given.insert(optionName(argv[i]));
+        Options::parse(argc, argv);
+        exclusive(processes() > 0, "processes", service()[0] != '\0', "service");
+        exclusive(anytime()[0] != '\0', "anytime", processes() > 0, "processes");
+        exclusive(anytime()[0] != '\0', "anytime", service()[0] != '\0', "service");
+    }
+    // Restart cutoffs, used with "-restart luby" or "-restart geometric".
+    // The nogoods of every restart are posted in the following runs.
+    // Satisfaction models enumerate all solutions by default.
+    void restartDefaults(void) {
+        restart_base(1.5);
+        restart_scale(250);
+        nogoods(true);
+        solutions(0);
+    }
+    // For satisfaction models, after the options are parsed: a restart
+    // would find the same solution again, hence restart-based search
+    // stops at the first one unless -solutions is given.
+    void restartSolutions(void) {
+        if (restart() != RM_NONE && !given("solutions"))
+            solutions(1);
+    }
+};
+
+// Branch on x with the heuristic selected by opt.branching().
+// Values are tried with val, except for BRANCH_MED which always
+// splits on the median. The default val records its commits when
+// tracing, see trace.hh. With restarts, ties between the smallest
+// domains are broken randomly so that every restart explores a
+// different tree.
+inline void branchHeuristic(Home home, const IntVarArgs& x, 
+                            const Options& opt, 
+                            IntValBranch val = Trace::valMaxBranch()) {
+    switch (opt.branching()) {
+        case BRANCH_AFC: 
+            branch(home, x, INT_VAR_AFC_SIZE_MAX(opt.decay()), val);
+            break;
+        case BRANCH_ACTIVITY: 
+            branch(home, x, INT_VAR_ACTION_SIZE_MAX(opt.decay()), val);
+            break;
+        case BRANCH_CHB: 
+            branch(home, x, INT_VAR_CHB_SIZE_MAX(), val);
+            break;
+        case BRANCH_MED: 
+            int_val_med(home, x);
+            break;
+        default:
+            if (opt.restart() == RM_NONE)
+                branch(home, x, INT_VAR_SIZE_MIN(), val);
+            else
+                branch(home, x, 
+                       tiebreak(INT_VAR_SIZE_MIN(), INT_VAR_RND(Rnd(opt.seed()))),
+                       val);
+    }
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __COMPAT_HH__
+#define __COMPAT_HH__
+
+#include <gecode/kernel.hh>
+
+// Gecode 6 dropped the share flag from cloning: spaces are copied
+// through Space(Space&) and copy(void), propagators and branchers
+// through (Space&, Propagator&) and copy(Space&). The macros expand
+// to the signatures of the Gecode version compiled against, e.g.
+//   Knights(SHARE_PARAM Knights& k) : Script(SHARE_ARG k) {
+//       x.update(*this, SHARE_ARG k.x);
+//   }
+//   virtual Space* copy(SHARE_VOID) { return new Knights(SHARE_ARG *this); }
+//   virtual Propagator* copy(Space& home SHARE_TAIL);
+#if GECODE_VERSION_NUMBER >= 600000
+#define SHARE_PARAM
+#define SHARE_ARG
+#define SHARE_VOID void
+#define SHARE_TAIL
+#else
+#define SHARE_PARAM bool share,
+#define SHARE_ARG share,
+#define SHARE_VOID bool share
+#define SHARE_TAIL , bool share
+#endif
+
+#endif
@@ -0,0 +1,667 @@
+#ifndef __DISTRIBUTED_HH__
+#define __DISTRIBUTED_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/search.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "solve.hh"
+
+using namespace Gecode;
+
+// Distributed search over worker processes on the same host.
+//
+// The coordinator splits the top of the search tree into jobs. A job
+// is the path from the root to a node, written as the archived choice
+// (Choice::archive) and the alternative taken at every step. Workers
+// are forked with a copy of the root space and talk to the coordinator
+// over a socket pair. A worker replays the path of its job with
+// Space::choice(Archive&) and commit, expands the node a few more
+// levels and searches the resulting subtrees one after the other.
+// When the job queue runs dry, the coordinator asks a busy worker to
+// give away half of its remaining subtrees, which become new jobs.
+//
+// Results of a job are only counted once the job is done, so a worker
+// that crashes is replaced and the subtrees of its job that it did not
+// give away are searched again; after MAX_CRASHES crashes the job is
+// given up and search is incomplete. A worker reports the subtrees of
+// its job as soon as it has expanded it, so that a crash does not rely
+// on expanding the job the same way again, which the random tie-breaks
+// of restart-based search do not. For optimisation, every improving
+// solution is reported at once and the best bound is sent to the other
+// workers.
+//
+// Workers search with the engine options of the command line. The
+// -time limit is a deadline shared by the coordinator and all
+// workers: the engines stop when it passes, and so does handing out
+// jobs.
+
+namespace Distributed {
+
+typedef std::vector<unsigned int> Message;
+// Path from the root: [steps, (alternative, size, archive...)*]
+typedef std::vector<unsigned int> Path;
+
+// Message types, the first word of every message
+enum {
+    JOB,      // coordinator: bounded, bound, path
+    STEAL,    // coordinator: give away part of the current job
+    BOUND,    // coordinator: a better bound has been found
+    EXPANDED, // worker: paths of the subtrees of the job
+    DONATE,   // worker: paths given away
+    IMPROVED, // worker: objective of an improving solution
+    DONE,     // worker: statistics and solutions of the job
+};
+
+// Subtrees a worker expands its job into
+const unsigned int LOCAL_LEVELS = 2;
+// Jobs per worker created by the initial split
+const unsigned int JOBS_PER_WORKER = 8;
+// Crashes of the workers searching a job before it is given up
+const unsigned int MAX_CRASHES = 3;
+// Time the workers get to report their jobs after the deadline, in ms
+const int GRACE = 1000;
+
+typedef std::chrono::steady_clock Clock;
+
+// The end of the -time limit, if any
+struct Deadline {
+    bool timed;
+    Clock::time_point at;
+    Deadline(const Options& opt)
+        : timed(opt.time() > 0),
+          at(Clock::now() + std::chrono::milliseconds(static_cast<long long int>(opt.time()))) {}
+    bool passed(void) const {
+        return timed && Clock::now() >= at;
+    }
+    // Milliseconds left, -1 if there is no limit
+    int left(void) const {
+        if (!timed)
+            return -1;
+        long long int ms = std::chrono::duration_cast<std::chrono::milliseconds>(at - Clock::now()).count();
+        return static_cast<int>(std::max(0LL, std::min(ms, 1LL << 30)));
+    }
+};
+
+// Write m with a length prefix; false if the peer is gone
+inline bool send(int fd, const Message& m) {
+    Message buf(1, m.size());
+    buf.insert(buf.end(), m.begin(), m.end());
+    const char* p = reinterpret_cast<const char*>(&buf[0]);
+    size_t left = buf.size() * sizeof(unsigned int);
+    while (left > 0) {
+        ssize_t w = write(fd, p, left);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w; left -= w;
+    }
+    return true;
+}
+
+inline bool readFully(int fd, void* data, size_t n) {
+    char* p = static_cast<char*>(data);
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r; n -= r;
+    }
+    return true;
+}
+
+// Read one message; false if the peer is gone
+inline bool receive(int fd, Message& m) {
+    unsigned int len;
+    if (!readFully(fd, &len, sizeof(len)))
+        return false;
+    m.resize(len);
+    return len == 0 || readFully(fd, &m[0], len * sizeof(unsigned int));
+}
+
+// Whether a message is waiting on fd
+inline bool pending(int fd) {
+    struct pollfd p;
+    p.fd = fd; p.events = POLLIN; p.revents = 0;
+    return poll(&p, 1, 0) > 0;
+}
+
+inline void putU64(Message& m, unsigned long int v) {
+    m.push_back(static_cast<unsigned int>(v >> 32));
+    m.push_back(static_cast<unsigned int>(v & 0xffffffffUL));
+}
+inline unsigned long int getU64(const Message& m, size_t& i) {
+    unsigned long int v = static_cast<unsigned long int>(m[i]) << 32 | m[i+1];
+    i += 2;
+    return v;
+}
+
+inline void putString(Message& m, const std::string& s) {
+    m.push_back(s.size());
+    for (size_t i = 0; i < s.size(); i += sizeof(unsigned int)) {
+        unsigned int w = 0;
+        s.copy(reinterpret_cast<char*>(&w), sizeof(unsigned int), i);
+        m.push_back(w);
+    }
+}
+inline std::string getString(const Message& m, size_t& i) {
+    size_t n = m[i++];
+    size_t words = (n + sizeof(unsigned int) - 1) / sizeof(unsigned int);
+    std::string s;
+    if (n > 0)
+        s.assign(reinterpret_cast<const char*>(&m[i]), n);
+    i += words;
+    return s;
+}
+
+inline void putPath(Message& m, const Path& p) {
+    m.push_back(p.size());
+    m.insert(m.end(), p.begin(), p.end());
+}
+inline Path getPath(const Message& m, size_t& i) {
+    size_t n = m[i++];
+    Path p(m.begin() + i, m.begin() + i + n);
+    i += n;
+    return p;
+}
+
+inline unsigned int length(const Path& p) {
+    return p.empty() ? 0 : p[0];
+}
+
+// Path to the child reached by alternative a of choice c
+inline Path extend(const Path& p, const Choice& c, unsigned int a) {
+    Archive e;
+    c.archive(e);
+    Path q(p);
+    if (q.empty())
+        q.push_back(0);
+    q[0]++;
+    q.push_back(a);
+    q.push_back(e.size());
+    for (int i = 0; i < e.size(); i++)
+        q.push_back(e[i]);
+    return q;
+}
+
+// Clone root and replay p on it; NULL if a node on the path fails
+template<class Model>
+Model* replay(const Model* root, const Path& p) {
+    Model* s = static_cast<Model*>(root->clone());
+    size_t i = 1;
+    for (unsigned int k = 0; k < length(p); k++) {
+        unsigned int a = p[i++];
+        unsigned int n = p[i++];
+        Archive e;
+        for (unsigned int j = 0; j < n; j++)
+            e.put(p[i++]);
+        if (s->status() == SS_FAILED) {
+            delete s;
+            return NULL;
+        }
+        const Choice* c = s->choice(e);
+        s->commit(*c, a);
+        delete c;
+    }
+    return s;
+}
+
+// Expand the node at p by levels and append the paths of the
+// non-failed nodes reached to out
+template<class Model>
+void expand(const Model* root, const Path& p, unsigned int levels,
+            std::deque<Path>& out) {
+    if (levels == 0) {
+        out.push_back(p);
+        return;
+    }
+    Model* s = replay(root, p);
+    if (s == NULL)
+        return;
+    switch (s->status()) {
+        case SS_FAILED: break;
+        case SS_SOLVED: out.push_back(p); break;
+        case SS_BRANCH: {
+            const Choice* c = s->choice();
+            for (unsigned int a = 0; a < c->alternatives(); a++)
+                expand(root, extend(p, *c, a), levels-1, out);
+            delete c;
+        } break;
+    }
+    delete s;
+}
+
+// Stops the engine of a worker when a message of the coordinator is
+// waiting, so that it is answered at once, or when the deadline has
+// passed. Polling for every node is too slow, so this is checked
+// every CHECK calls.
+class Interrupt : public Search::Stop {
+protected:
+    int fd;
+    const Deadline& deadline;
+    std::atomic<unsigned long int> calls;
+    std::atomic<bool> over;
+public:
+    static const unsigned long int CHECK = 256;
+    Interrupt(int f, const Deadline& d)
+        : fd(f), deadline(d), calls(0), over(false) {}
+    virtual bool stop(const Search::Statistics&, const Search::Options&) {
+        if (++calls % CHECK != 0)
+            return false;
+        if (deadline.passed())
+            over = true;
+        return over || pending(fd);
+    }
+    bool expired(void) const {
+        return over;
+    }
+};
+
+// Accumulated statistics of a job
+struct Result {
+    unsigned long int solutions, nodes, failures, propagations, depth;
+    Result(void) : solutions(0), nodes(0), failures(0), propagations(0), depth(0) {}
+};
+
+template<class Model, template<class> class Engine, class Objective>
+void worker(int fd, const Model* root, const Options& opt, const Deadline& deadline) {
+    bool print = opt.mode() == SM_SOLUTION;
+    Interrupt interrupt(fd, deadline);
+    Message m;
+    while (receive(fd, m)) {
+        if (m.empty()) continue;
+        if (m[0] == STEAL) {
+            // Asked while idle: nothing to give away
+            if (!send(fd, Message(1, DONATE))) return;
+            continue;
+        }
+        if (m[0] != JOB) continue;
+        size_t i = 1;
+        bool bounded = m[i++] != 0;
+        int bound = static_cast<int>(m[i++]);
+        Path job = getPath(m, i);
+
+        std::deque<Path> todo;
+        expand(root, job, LOCAL_LEVELS, todo);
+        Message x(1, EXPANDED);
+        x.push_back(todo.size());
+        for (size_t k = 0; k < todo.size(); k++)
+            putPath(x, todo[k]);
+        if (!send(fd, x)) return;
+        Result r;
+        // The objective of the best solution of the job; bound may be
+        // better, from the solutions of other workers
+        bool improved = false;
+        int best = 0;
+        std::ostringstream text;
+        // The solutions asked for by -solutions are found, which only
+        // ends the search of satisfaction models
+        auto enough = [&]() {
+            return opt.solutions() > 0 && r.solutions >= opt.solutions() && !improved;
+        };
+        // Answer the waiting messages: give away half of the subtrees
+        // not yet started, and keep the best bound for the next ones
+        auto answer = [&]() {
+            while (pending(fd)) {
+                Message q;
+                if (!receive(fd, q)) return false;
+                if (q.empty()) continue;
+                if (q[0] == STEAL) {
+                    Message d(1, DONATE);
+                    size_t n = todo.size() / 2;
+                    d.push_back(n);
+                    for (size_t k = 0; k < n; k++) {
+                        putPath(d, todo.back());
+                        todo.pop_back();
+                    }
+                    if (!send(fd, d)) return false;
+                } else if (q[0] == BOUND) {
+                    int b = static_cast<int>(q[1]);
+                    if (!bounded || Objective::better(b, bound)) {
+                        bounded = true; bound = b;
+                    }
+                }
+            }
+            return true;
+        };
+        while (!todo.empty() && !interrupt.expired()) {
+            if (!answer()) return;
+            Path p = todo.front();
+            todo.pop_front();
+            Model* s = replay(root, p);
+            if (s == NULL) continue;
+            if (bounded)
+                Objective::bound(*s, bound);
+            Search::Options so = Solve::options(opt, false);
+            so.stop = &interrupt;
+            Search::Base<Model>* e = Solve::engine<Model,Engine>(s, so);
+            bool lost = false;
+            Solve::Outcome o;
+            // The engine stops for every message and resumes once it
+            // is answered
+            do {
+                o = Solve::loop(*e, 0,
+                    [&](Model* t, const Search::Statistics&) {
+                        r.solutions++;
+                        int v;
+                        if (Objective::value(*t, v)) {
+                            // Only the best solution of the job is kept
+                            bounded = true; bound = v;
+                            improved = true; best = v;
+                            Message im(1, IMPROVED);
+                            im.push_back(static_cast<unsigned int>(v));
+                            lost = !send(fd, im);
+                            if (print) {
+                                text.str("");
+                                t->print(text);
+                            }
+                        } else if (print) {
+                            t->print(text);
+                        }
+                        delete t;
+                        return !lost && !enough();
+                    });
+                lost = lost || !answer();
+            } while (o.stopped && !lost && !interrupt.expired());
+            delete e;
+            if (lost) return;
+            r.nodes += o.stat.node;
+            r.failures += o.stat.fail;
+            r.propagations += o.stat.propagate;
+            r.depth = std::max(r.depth, length(p) + o.stat.depth);
+            if (enough())
+                break;
+        }
+
+        Message d(1, DONE);
+        putU64(d, r.solutions);
+        putU64(d, r.nodes);
+        putU64(d, r.failures);
+        putU64(d, r.propagations);
+        putU64(d, r.depth);
+        d.push_back(improved);
+        d.push_back(static_cast<unsigned int>(best));
+        d.push_back(interrupt.expired());
+        putString(d, text.str());
+        if (!send(fd, d)) return;
+    }
+}
+
+// A job: the path to its root, the subtrees its worker expanded it
+// into, if reported yet, and those of them already given away
+struct Job {
+    Path path;
+    bool expanded;
+    std::vector<Path> subtrees;
+    std::vector<Path> skip;
+    unsigned int crashes;
+    Job(void) : expanded(false), crashes(0) {}
+};
+
+struct Worker {
+    pid_t pid;
+    int fd;
+    bool busy;
+    bool stealing;
+    Job job;
+};
+
+template<class Model, template<class> class Engine, class Objective>
+bool spawn(Worker& w, const std::vector<Worker>& all,
+           const Model* root, const Options& opt, const Deadline& deadline) {
+    int sv[2];
+    std::cout.flush();
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        return false;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]); close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(sv[0]);
+        for (size_t i = 0; i < all.size(); i++)
+            if (all[i].fd >= 0)
+                close(all[i].fd);
+        worker<Model,Engine,Objective>(sv[1], root, opt, deadline);
+        _exit(0);
+    }
+    close(sv[1]);
+    w.pid = pid; w.fd = sv[0];
+    w.busy = false; w.stealing = false;
+    return true;
+}
+
+// Search the model built from opt with processes workers using Engine,
+// printing solutions and statistics like Script::run.
+template<class Model, template<class> class Engine, class Objective, class Opt>
+void run(const Opt& opt, unsigned int processes) {
+    signal(SIGPIPE, SIG_IGN);
+    Support::Timer t;
+    t.start();
+    Deadline deadline(opt);
+    Model* root = new Model(opt);
+    std::vector<Worker> workers(processes);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].fd = -1;
+
+    // Initial split, breadth first
+    std::deque<Job> queue;
+    if (root->status() != SS_FAILED) {
+        std::deque<Path> open(1, Path());
+        std::vector<Path> leaves;
+        while (!open.empty() &&
+               open.size() + leaves.size() < JOBS_PER_WORKER * processes) {
+            Path p = open.front();
+            open.pop_front();
+            Model* s = replay(root, p);
+            if (s == NULL) continue;
+            SpaceStatus st = s->status();
+            if (st == SS_BRANCH) {
+                const Choice* c = s->choice();
+                for (unsigned int a = 0; a < c->alternatives(); a++)
+                    open.push_back(extend(p, *c, a));
+                delete c;
+            } else if (st == SS_SOLVED) {
+                leaves.push_back(p);
+            }
+            delete s;
+        }
+        open.insert(open.end(), leaves.begin(), leaves.end());
+        for (size_t i = 0; i < open.size(); i++) {
+            Job j;
+            j.path = open[i];
+            queue.push_back(j);
+        }
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        if (!spawn<Model,Engine,Objective>(workers[i], workers, root, opt, deadline)) {
+            std::cerr << "cannot start worker process" << std::endl;
+            exit(1);
+        }
+
+    Result total;
+    bool bounded = false;
+    int bound = 0;
+    unsigned int restarted = 0, abandoned = 0;
+    bool limit = false, stopped = false, late = false;
+    while (!limit) {
+        if (!stopped && deadline.passed()) {
+            // The workers stop by themselves; their jobs are reported
+            // within the grace period
+            stopped = true;
+            queue.clear();
+        }
+        // Hand out jobs to idle workers
+        for (size_t i = 0; i < workers.size() && !queue.empty(); i++) {
+            Worker& w = workers[i];
+            if (w.busy) continue;
+            w.job = queue.front();
+            queue.pop_front();
+            Message m(1, JOB);
+            m.push_back(bounded);
+            m.push_back(static_cast<unsigned int>(bound));
+            putPath(m, w.job.path);
+            w.busy = true;
+            (void) send(w.fd, m); // a failure shows up as a crash below
+        }
+        // Ask busy workers for work on behalf of the idle ones
+        size_t idle = 0, asked = 0;
+        for (size_t i = 0; i < workers.size(); i++) {
+            idle += !workers[i].busy;
+            asked += workers[i].stealing;
+        }
+        if (idle == workers.size() && queue.empty())
+            break;
+        for (size_t i = 0; i < workers.size() && asked < idle && !stopped; i++)
+            if (workers[i].busy && !workers[i].stealing) {
+                workers[i].stealing = true;
+                asked++;
+                (void) send(workers[i].fd, Message(1, STEAL));
+            }
+
+        std::vector<struct pollfd> fds(workers.size());
+        for (size_t i = 0; i < workers.size(); i++) {
+            fds[i].fd = workers[i].fd; fds[i].events = POLLIN; fds[i].revents = 0;
+        }
+        int wait = stopped ? GRACE : deadline.left();
+        int ready = poll(&fds[0], fds.size(), wait);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready == 0 && stopped) {
+            // Late workers are killed below
+            late = true;
+            break;
+        }
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            Worker& w = workers[i];
+            Message m;
+            if (!receive(w.fd, m) || m.empty()) {
+                // The worker died: search the subtrees of its job
+                // it kept again, or the whole job if they are not
+                // known yet, unless it has crashed too often
+                close(w.fd);
+                waitpid(w.pid, NULL, 0);
+                if (w.busy && ++w.job.crashes >= MAX_CRASHES) {
+                    std::cerr << "giving up a job after " << MAX_CRASHES
+                              << " crashes" << std::endl;
+                    abandoned++;
+                } else if (w.busy && !stopped && !w.job.expanded) {
+                    queue.push_front(w.job);
+                } else if (w.busy && !stopped) {
+                    const std::vector<Path>& given = w.job.skip;
+                    for (size_t k = 0; k < w.job.subtrees.size(); k++)
+                        if (std::find(given.begin(), given.end(),
+                                      w.job.subtrees[k]) == given.end()) {
+                            Job j;
+                            j.path = w.job.subtrees[k];
+                            j.crashes = w.job.crashes;
+                            queue.push_front(j);
+                        }
+                }
+                w.busy = false;
+                restarted++;
+                w.fd = -1;
+                if (!spawn<Model,Engine,Objective>(w, workers, root, opt, deadline)) {
+                    std::cerr << "cannot restart worker process" << std::endl;
+                    exit(1);
+                }
+                continue;
+            }
+            size_t k = 1;
+            if (m[0] == EXPANDED) {
+                w.job.expanded = true;
+                unsigned int n = m[k++];
+                for (unsigned int d = 0; d < n; d++)
+                    w.job.subtrees.push_back(getPath(m, k));
+            } else if (m[0] == DONATE) {
+                w.stealing = false;
+                unsigned int n = m.size() > 1 ? m[k++] : 0;
+                for (unsigned int d = 0; d < n; d++) {
+                    Job j;
+                    j.path = getPath(m, k);
+                    w.job.skip.push_back(j.path);
+                    queue.push_back(j);
+                }
+            } else if (m[0] == IMPROVED) {
+                int v = static_cast<int>(m[1]);
+                if (!bounded || Objective::better(v, bound)) {
+                    bounded = true; bound = v;
+                    Message b(1, BOUND);
+                    b.push_back(m[1]);
+                    for (size_t o = 0; o < workers.size(); o++)
+                        if (o != i && workers[o].busy)
+                            (void) send(workers[o].fd, b);
+                }
+            } else if (m[0] == DONE) {
+                Result r;
+                r.solutions = getU64(m, k);
+                r.nodes = getU64(m, k);
+                r.failures = getU64(m, k);
+                r.propagations = getU64(m, k);
+                r.depth = getU64(m, k);
+                bool improved = m[k++] != 0;
+                int v = static_cast<int>(m[k++]);
+                stopped = stopped || m[k++] != 0;
+                std::string text = getString(m, k);
+                total.solutions += r.solutions;
+                total.nodes += r.nodes;
+                total.failures += r.failures;
+                total.propagations += r.propagations;
+                total.depth = std::max(total.depth, r.depth);
+                // Print the job's solutions, for optimisation only
+                // if it is still the best one
+                if (!improved || v == bound)
+                    std::cout << text;
+                w.busy = false;
+                if (!improved && opt.solutions() > 0 &&
+                    total.solutions >= opt.solutions())
+                    limit = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        close(workers[i].fd);
+        if (limit || late)
+            kill(workers[i].pid, SIGTERM);
+        waitpid(workers[i].pid, NULL, 0);
+    }
+    delete root;
+
+    double ms = t.stop();
+    std::cout << std::endl
+              << (stopped || abandoned > 0 ? "Distributed search stopped" : "Distributed search")
+              << std::endl
+              << "\truntime:      " << ms / 1000 << " (" << ms << " ms)" << std::endl
+              << "\tsolutions:    " << total.solutions << std::endl
+              << "\tpropagations: " << total.propagations << std::endl
+              << "\tnodes:        " << total.nodes << std::endl
+              << "\tfailures:     " << total.failures << std::endl
+              << "\tpeak depth:   " << total.depth << std::endl
+              << "\tprocesses:    " << processes << std::endl
+              << "\trestarted:    " << restarted << std::endl
+              << "\tabandoned:    " << abandoned << std::endl;
+}
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef __DZN_HH__
+#define __DZN_HH__
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Reader for the MiniZinc data files (.dzn) shipped with the models.
+//
+// Supported are the assignments "name = value;" where value is
+//   an integer expression of literals, names and + or -, e.g. 2 + 2 + 2
+//   an enumeration { S1, S2, S3 }, whose members become the integers
+//     1, 2, 3 as in MiniZinc
+//   an array [ a, b, c ] or a 2-D array [| a, b | c, d |] of integer
+//     expressions, read row by row
+// and comments from % to the end of the line. An identifier that is
+// neither a member nor a name, such as "C" in "stage = C;", is read as
+// a string with ident().
+class Dzn {
+protected:
+    std::string filename;
+    // errors throw std::runtime_error instead of ending the process
+    bool throws;
+    // elements of every assignment, a single one for scalars
+    std::map<std::string, std::vector<std::string> > values;
+    // members of the enumerations and their ordinals
+    std::map<std::string, int> members;
+
+    static std::string trim(const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos)
+            return "";
+        size_t e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+    }
+    // Split s at every character of separators, dropping empty parts
+    static std::vector<std::string> split(const std::string& s, const char* separators) {
+        std::vector<std::string> result;
+        std::string part;
+        for (size_t i = 0; i <= s.size(); i++)
+            if (i == s.size() || std::strchr(separators, s[i]) != NULL) {
+                part = trim(part);
+                if (!part.empty())
+                    result.push_back(part);
+                part.clear();
+            } else {
+                part += s[i];
+            }
+        return result;
+    }
+    // Value of an integer expression
+    int evaluate(const std::string& e) const {
+        int sum = 0, sign = 1;
+        std::string term;
+        for (size_t i = 0; i <= e.size(); i++) {
+            if (i < e.size() && e[i] != '+' && e[i] != '-') {
+                term += e[i];
+                continue;
+            }
+            term = trim(term);
+            if (!term.empty()) {
+                if (std::isdigit(static_cast<unsigned char>(term[0])))
+                    sum += sign * std::atoi(term.c_str());
+                else if (members.count(term) > 0)
+                    sum += sign * members.find(term)->second;
+                else
+                    sum += sign * integer(term);
+                term.clear();
+            }
+            if (i < e.size())
+                sign = e[i] == '-' ? -1 : 1;
+        }
+        return sum;
+    }
+    const std::vector<std::string>& find(const std::string& name) const {
+        std::map<std::string, std::vector<std::string> >::const_iterator i =
+            values.find(name);
+        if (i == values.end())
+            error("missing " + name);
+        return i->second;
+    }
+public:
+    // Read filename, ending the process if it cannot be read, or
+    // throwing if t, as in service requests
+    explicit Dzn(const std::string& f, bool t = false) : filename(f), throws(t) {
+        std::ifstream is(filename.c_str());
+        if (!is.is_open())
+            error("cannot open the data file");
+        std::string text, line;
+        while (std::getline(is, line))
+            text += line.substr(0, line.find('%')) + "\n";
+        std::vector<std::string> statements = split(text, ";");
+        for (size_t i = 0; i < statements.size(); i++) {
+            size_t eq = statements[i].find('=');
+            if (eq == std::string::npos)
+                error("expected an assignment in \"" + statements[i] + "\"");
+            std::string name = trim(statements[i].substr(0, eq));
+            std::string value = trim(statements[i].substr(eq + 1));
+            if (!value.empty() && value[0] == '{') {
+                std::vector<std::string> set = split(value, "{,}");
+                for (size_t k = 0; k < set.size(); k++)
+                    members[set[k]] = static_cast<int>(k) + 1;
+                values[name] = set;
+            } else if (!value.empty() && value[0] == '[') {
+                values[name] = split(value, "[|,]");
+            } else {
+                values[name] = std::vector<std::string>(1, value);
+            }
+        }
+    }
+    // Report an error in the data and end the process, or throw
+    void error(const std::string& message) const {
+        if (throws)
+            throw std::runtime_error(filename + ": " + message);
+        std::cerr << filename << ": " << message << std::endl;
+        exit(1);
+    }
+    bool has(const std::string& name) const {
+        return values.count(name) > 0;
+    }
+    // Integer value of a scalar
+    int integer(const std::string& name) const {
+        return evaluate(find(name)[0]);
+    }
+    // Identifier assigned to a scalar, e.g. the stage
+    std::string ident(const std::string& name) const {
+        return find(name)[0];
+    }
+    // Elements of an array, row by row for 2-D arrays
+    std::vector<int> array(const std::string& name) const {
+        const std::vector<std::string>& v = find(name);
+        std::vector<int> result;
+        for (size_t i = 0; i < v.size(); i++)
+            result.push_back(evaluate(v[i]));
+        return result;
+    }
+    // Number of members of an enumeration
+    int size(const std::string& name) const {
+        return static_cast<int>(find(name).size());
+    }
+};
+
+#endif
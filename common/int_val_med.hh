@@ -0,0 +1,117 @@
+#ifndef __INT_VAL_MED_HH__
+#define __INT_VAL_MED_HH__
+
+#include <gecode/int.hh>
+
+#include "compat.hh"
+#include "trace.hh"
+
+using namespace Gecode;
+
+// Brancher that selects the variable with the smallest domain and
+// splits on the median value of its domain: x = med, x != med.
+class int_val_med : public Brancher { 
+protected: 
+    ViewArray<Int::IntView> x; 
+    mutable int start;
+    // choice definition 
+    class PosVal : public Choice { 
+    public: 
+        int pos; 
+        int val; 
+        PosVal(const int_val_med& b, int p, int v)
+            : Choice(b,2), pos(p), val(v) {} 
+        virtual size_t size(void) const {   
+            return sizeof(*this); 
+        }
+        virtual void archive(Archive& e) const { 
+            Choice::archive(e); 
+            e << pos << val; 
+        } 
+    }; 
+public: 
+    int_val_med(Home home, ViewArray<Int::IntView>& x0)
+        : Brancher(home), x(x0), start(0) {} 
+    //posting
+    static void post(Home home, ViewArray<Int::IntView>& x) { 
+        (void) new (home) int_val_med(home,x); 
+    } 
+    //disposal
+    virtual size_t dispose(Space& home) { 
+        (void) Brancher::dispose(home); 
+        return sizeof(*this); 
+    } 
+    //choice 
+    virtual const Choice*  choice(Space&) {
+        // Find the variable with min domain
+        int p = start;
+        unsigned int s = x[p].size();
+        for (int i=start+1; i<x.size(); i++){
+            if (!x[i].assigned() && (x[i].size() < s)) {
+                p = i; s = x[p].size();
+            }            
+        }
+        // Find the m/2
+        int counter = x[p].size() / 2; // Loop until counter deduced to 1
+        int cur_val = x[p].min()-1;
+        while(counter > 0){
+            cur_val ++;
+            if (x[p].in(cur_val))
+                counter --;
+        }
+        return new PosVal(*this,p,cur_val);
+        // return new PosVal(*this,p,x[p].min());
+    }
+    virtual const Choice*  choice(const Space&, Archive& e) {
+        int pos, val;
+        e>>pos>>val;
+        return new PosVal(*this, pos, val);
+    }
+    //copy
+    int_val_med(Space& home, SHARE_PARAM int_val_med& b) 
+        : Brancher(home, SHARE_ARG b), start(b.start) { 
+        x.update(home, SHARE_ARG b.x); 
+    } 
+    virtual Brancher* copy(Space& home SHARE_TAIL) { 
+        return new (home) int_val_med(home, SHARE_ARG *this); 
+    }
+    // status 
+    virtual bool status(const Space&) const { 
+        for (int i=start; i<x.size(); i++)
+            if(!x[i].assigned()){
+                start = i;
+                return true;
+            }
+        return false; 
+    } 
+    // commit 
+    virtual ExecStatus commit(Space& home, 
+                              const Choice& c, 
+                              unsigned int a) {
+        const PosVal& pv = static_cast<const PosVal&>(c); 
+        int pos=pv.pos, val=pv.val; 
+        Trace::commit(home, a, pos, val);
+        if (a == 0) 
+            return me_failed(x[pos].eq(home,val)) ? ES_FAILED : ES_OK; 
+        else 
+            return me_failed(x[pos].nq(home,val)) ? ES_FAILED : ES_OK; 
+    } 
+    // print 
+    virtual void print(const Space&, const Choice& c, unsigned int a, std::ostream& o) const { 
+        const PosVal& pv = static_cast<const PosVal&>(c); 
+        int pos=pv.pos, val=pv.val; 
+        if (a == 0) 
+            o << "x[" << pos << "] = " << val; 
+        else 
+            o << "x[" << pos << "] != " << val; 
+    } 
+}; 
+
+inline void int_val_med(Home home, const IntVarArgs& x) { 
+    if (home.failed()) 
+        return; 
+    ViewArray<Int::IntView> y(home,x); 
+    int_val_med::post(home,y); 
+} 
+
+#endif
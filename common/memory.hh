@@ -0,0 +1,191 @@
+#ifndef __MEMORY_HH__
+#define __MEMORY_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/search.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "anytime.hh"
+#include "distributed.hh"
+#include "solve.hh"
+
+using namespace Gecode;
+
+// Branch and bound under a memory limit, for -memory MB.
+//
+// Only the incumbent is kept, and it is printed once search ends. The
+// engine is stopped when the resident set size of the process exceeds
+// the limit. Gecode does not hand out the open nodes of a stopped
+// engine, so the subtree it searched is split into the subtrees of its
+// children, kept as paths from the root as in distributed.hh, and
+// search goes on with them, with the incumbent as bound and twice the
+// recomputation distance: fewer copies are kept on the stack at the
+// price of recomputing more. Subtrees already searched are not searched
+// again; only the work in the split subtree is lost. It gives up when
+// the limit is already used up before a subtree, or after MAX_ROUNDS
+// splits.
+
+namespace Memory {
+
+// Resident set size of the process in bytes, 0 if unknown
+inline unsigned long int resident(void) {
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+    unsigned long int size = 0, pages = 0;
+    if (std::fscanf(f, "%lu %lu", &size, &pages) != 2)
+        pages = 0;
+    std::fclose(f);
+    return pages * static_cast<unsigned long int>(sysconf(_SC_PAGESIZE));
+}
+
+// Stops when the resident set size exceeds limit bytes, or when next
+// (if any) stops. Reading /proc is too slow for every node, so the
+// size is checked every CHECK calls.
+class Stop : public Search::Stop {
+protected:
+    unsigned long int limit;
+    Search::Stop* next;
+    std::atomic<unsigned long int> calls;
+    std::atomic<bool> exceeded;
+public:
+    static const unsigned long int CHECK = 1024;
+    Stop(unsigned long int l, Search::Stop* n)
+        : limit(l), next(n), calls(0), exceeded(false) {}
+    virtual bool stop(const Search::Statistics& s, const Search::Options& o) {
+        if (!exceeded && ++calls % CHECK == 0 && resident() > limit)
+            exceeded = true;
+        return exceeded || (next != NULL && next->stop(s, o));
+    }
+    bool hit(void) const {
+        return exceeded;
+    }
+};
+
+// Largest recomputation distance tried
+const unsigned int MAX_C_D = 1 << 16;
+// Subtrees split before giving up
+const unsigned int MAX_ROUNDS = 256;
+
+// Search the model built from opt with BAB and the engine options of
+// opt, within limit MB and the time limit of opt, printing the best
+// solution and the statistics.
+// Objective is one of solve.hh; the incumbents of all rounds are
+// written to the file anytime, if given.
+template<class Model, class Objective, class Opt>
+void run(const Opt& opt, unsigned int limit, const char* anytime = NULL) {
+    Anytime::Log log;
+    Support::Timer t;
+    t.start();
+    unsigned long int bytes = static_cast<unsigned long int>(limit) << 20;
+    Model* root = new Model(opt);
+    // Subtrees still to search, as paths from the root
+    std::deque<Distributed::Path> open;
+    int v;
+    if (root->status() != SS_FAILED) {
+        if (Objective::limit(*root, v))
+            log.limit(v);
+        open.push_back(Distributed::Path());
+    }
+    Model* best = NULL;
+    unsigned int c_d = std::max(opt.c_d(), 1u);
+    unsigned long int solutions = 0, propagations = 0, nodes = 0, failures = 0;
+    unsigned long int depth = 0, rounds = 0;
+    while (!open.empty()) {
+        // Give freed engine memory back, so that it is not counted
+        (void) malloc_trim(0);
+        if (resident() >= bytes) {
+            std::cout << "memory limit: " << limit << " MB used up before search" << std::endl;
+            break;
+        }
+        double left = opt.time() > 0 ? opt.time() - t.stop() : 0;
+        if (opt.time() > 0 && left <= 0)
+            break;
+        Search::TimeStop* time = opt.time() > 0 ?
+            new Search::TimeStop(static_cast<unsigned long int>(left)) : NULL;
+        Stop stop(bytes, time);
+
+        Distributed::Path p = open.front();
+        Model* r = Distributed::replay(root, p);
+        if (r == NULL) {
+            delete time;
+            open.pop_front();
+            continue;
+        }
+        if (best != NULL && Objective::value(*best, v))
+            Objective::bound(*r, v);
+        Search::Options so = Solve::options(opt, false);
+        so.c_d = c_d;
+        so.a_d = std::min(opt.a_d(), c_d);
+        so.stop = &stop;
+        Search::Base<Model>* e = Solve::engine<Model,BAB>(r, so);
+        Solve::Outcome o = Solve::loop(*e, 0,
+            [&](Model* s, const Search::Statistics& stat) {
+                delete best;
+                best = s;
+                if (Objective::value(*s, v))
+                    log.add(nodes + stat.node, failures + stat.fail, v);
+                return true;
+            });
+        delete e;
+        solutions += o.solutions;
+        propagations += o.stat.propagate;
+        nodes += o.stat.node;
+        failures += o.stat.fail;
+        depth = std::max(depth, static_cast<unsigned long int>(
+            Distributed::length(p) + o.stat.depth));
+        bool memory = stop.hit();
+        delete time;
+        if (!o.stopped) {
+            open.pop_front();
+            continue;
+        }
+        if (!memory || rounds == MAX_ROUNDS)
+            break;
+        rounds++;
+        open.pop_front();
+        std::deque<Distributed::Path> children;
+        Distributed::expand(root, p, 1, children);
+        open.insert(open.begin(), children.begin(), children.end());
+        c_d = std::min(2 * c_d, MAX_C_D);
+        std::cout << "memory limit: splitting a subtree at depth "
+                  << Distributed::length(p) << " with -c_d " << c_d;
+        if (best != NULL && Objective::value(*best, v))
+            std::cout << " from objective " << v;
+        std::cout << std::endl;
+    }
+    bool complete = open.empty();
+    delete root;
+    log.finish(complete);
+
+    if (best != NULL) {
+        best->print(std::cout);
+        delete best;
+    }
+    double ms = t.stop();
+    std::cout << std::endl
+              << (complete ? "Search complete" : "Search stopped") << std::endl
+              << "\truntime:      " << ms / 1000 << " (" << ms << " ms)" << std::endl
+              << "\tsolutions:    " << solutions << std::endl
+              << "\tpropagations: " << propagations << std::endl
+              << "\tnodes:        " << nodes << std::endl
+              << "\tfailures:     " << failures << std::endl
+              << "\tpeak depth:   " << depth << std::endl
+              << "\trounds:       " << rounds << std::endl
+              << "\tfinal c_d:    " << c_d << std::endl;
+    if (anytime != NULL)
+        log.report(anytime);
+}
+
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef __SERVICE_HH__
+#define __SERVICE_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/search.hh>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "solve.hh"
+
+using namespace Gecode;
+
+// Service mode of the drivers, started with "-service -" to read
+// requests from stdin or "-service path" to listen on a Unix socket.
+//
+// A request is one line: an id followed by the arguments of the
+// command line of the driver, for example
+//   7 -time 500 -solutions 1 8
+// Requests are solved by a pool of -threads worker threads (0 for one
+// per core), so one process serves any number of instances. Every
+// response is written as a whole:
+//   begin 7
+//   <solutions, unless -mode stat>
+//   <statistics>
+//   end 7 complete|stopped|error
+// where stopped means the -time limit of the request was hit, and
+// error that the request was rejected, with the reason in the
+// response. Handlers mark their options with DriverOptions::request,
+// so options are checked before they are parsed, data errors throw
+// instead of ending the process, and what the models report while
+// they are built goes to the response.
+
+namespace Service {
+
+// Solve one request given as command line arguments, writing the
+// solutions and statistics to os; returns false if search was stopped
+typedef std::function<bool(int argc, char* argv[], std::ostream& os)> Handler;
+
+// Search the model built from opt with engine E, restart-based if
+// requested, within the time limit of opt
+template<class Model, template<class> class Engine, class Opt>
+bool solve(const Opt& opt, std::ostream& os) {
+    Support::Timer t;
+    t.start();
+    Search::Options so = Solve::options(opt);
+    Search::Base<Model>* e = Solve::engine<Model,Engine>(new Model(opt), so);
+    bool print = opt.mode() != SM_STAT;
+    Solve::Outcome o = Solve::loop(*e, opt.solutions(),
+        [&](Model* s, const Search::Statistics&) {
+            if (print)
+                s->print(os);
+            delete s;
+            return true;
+        });
+    Solve::statistics(os, t.stop(), o.solutions, o.stat);
+    delete e;
+    delete so.stop;
+    return !o.stopped;
+}
+
+// Input and output of a client: stdin and stdout, or a connection
+struct Client {
+    int in, out;
+    std::mutex lock; // held while a response is written
+    Client(int i, int o) : in(i), out(o) {}
+    ~Client(void) {
+        if (in != STDIN_FILENO)
+            close(in);
+    }
+};
+
+struct Request {
+    std::shared_ptr<Client> client;
+    std::string line;
+};
+
+// Requests waiting for a worker
+class Queue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<Request> requests;
+    bool closed;
+public:
+    Queue(void) : closed(false) {}
+    void push(const Request& r) {
+        std::lock_guard<std::mutex> l(m);
+        requests.push_back(r);
+        cv.notify_one();
+    }
+    // No more requests will be pushed
+    void close(void) {
+        std::lock_guard<std::mutex> l(m);
+        closed = true;
+        cv.notify_all();
+    }
+    // Wait for the next request; false once closed and empty
+    bool pop(Request& r) {
+        std::unique_lock<std::mutex> l(m);
+        cv.wait(l, [this]() { return closed || !requests.empty(); });
+        if (requests.empty())
+            return false;
+        r = requests.front();
+        requests.pop_front();
+        return true;
+    }
+};
+
+// Read the next line of fd, keeping what follows it in buffer;
+// false at the end of the input
+inline bool readLine(int fd, std::string& buffer, std::string& line) {
+    char chunk[4096];
+    while (true) {
+        size_t eol = buffer.find('\n');
+        if (eol != std::string::npos) {
+            line = buffer.substr(0, eol);
+            buffer.erase(0, eol + 1);
+            return true;
+        }
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            // a last line without newline
+            line.swap(buffer);
+            buffer.clear();
+            return !line.empty();
+        }
+        buffer.append(chunk, n);
+    }
+}
+
+inline bool writeAll(int fd, const std::string& s) {
+    size_t done = 0;
+    while (done < s.size()) {
+        ssize_t n = write(fd, s.data() + done, s.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+// Solve one request and write its response
+inline void answer(const Handler& handler, const Request& r) {
+    std::istringstream is(r.line);
+    std::vector<std::string> args;
+    std::string arg;
+    while (is >> arg)
+        args.push_back(arg);
+    if (args.empty() || args[0][0] == '#')
+        return;
+    // The id takes the place of the program name
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); i++)
+        argv.push_back(&args[i][0]);
+    argv.push_back(NULL);
+    std::string id = args[0];
+
+    std::ostringstream os;
+    os << "begin " << id << std::endl;
+    const char* status;
+    try {
+        status = handler(static_cast<int>(args.size()), &argv[0], os)
+            ? "complete" : "stopped";
+    } catch (Exception& e) {
+        os << "\terror:        " << e.what() << std::endl;
+        status = "error";
+    } catch (std::exception& e) {
+        os << "\terror:        " << e.what() << std::endl;
+        status = "error";
+    }
+    os << "end " << id << " " << status << std::endl;
+    std::lock_guard<std::mutex> l(r.client->lock);
+    (void) writeAll(r.client->out, os.str());
+}
+
+// Push the requests of a client until its input ends
+inline void readRequests(std::shared_ptr<Client> client, std::shared_ptr<Queue> queue) {
+    std::string buffer, line;
+    while (readLine(client->in, buffer, line)) {
+        Request r;
+        r.client = client;
+        r.line = line;
+        queue->push(r);
+    }
+}
+
+// Serve requests from where ("-" for stdin) with the given number of
+// worker threads until the input ends or the socket fails
+inline int serve(const std::string& where, unsigned int workers,
+                 const Handler& handler) {
+    signal(SIGPIPE, SIG_IGN);
+    std::shared_ptr<Queue> queue = std::make_shared<Queue>();
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < std::max(workers, 1u); i++)
+        pool.push_back(std::thread([queue, &handler]() {
+            // A request keeps its client open, so it is dropped at once
+            for (Request r; queue->pop(r); r = Request())
+                answer(handler, r);
+        }));
+
+    int result = 0;
+    if (where == "-") {
+        readRequests(std::make_shared<Client>(STDIN_FILENO, STDOUT_FILENO), queue);
+    } else {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, where.c_str(), sizeof(addr.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(where.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(fd, 16) < 0) {
+            std::cerr << "cannot listen on " << where << ": " << strerror(errno) << std::endl;
+            result = 1;
+        } else {
+            while (true) {
+                int c = accept(fd, NULL, NULL);
+                if (c < 0 && errno == EINTR)
+                    continue;
+                if (c < 0)
+                    break;
+                std::thread(readRequests, std::make_shared<Client>(c, c), queue).detach();
+            }
+            std::cerr << "accept failed: " << strerror(errno) << std::endl;
+            result = 1;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+    queue->close();
+    for (size_t i = 0; i < pool.size(); i++)
+        pool[i].join();
+    return result;
+}
+
+// Threads given by the -threads option, 0 for one per core
+inline unsigned int threads(const Options& opt) {
+    return opt.threads() >= 1 ?
+        static_cast<unsigned int>(opt.threads()) : std::thread::hardware_concurrency();
+}
+
+}
+
+#endif
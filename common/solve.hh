@@ -0,0 +1,143 @@
+#ifndef __SOLVE_HH__
+#define __SOLVE_HH__
+
+#include <gecode/driver.hh>
+#include <gecode/search.hh>
+
+#include <iostream>
+
+using namespace Gecode;
+
+// The search loop shared by the service, -anytime, -memory, the
+// workers of distributed search and the benchmarks: the engine options
+// taken from the command line, the engine, and one loop over the
+// solutions that hands every solution to a hook.
+
+namespace Solve {
+
+// Objective of a model with
+//   get_obj_value()  the objective of a solution
+//   get_obj_bound()  the best objective still possible
+//   improve(v)       only allow solutions better than v
+// where larger objectives are better if maximise. value(s, v) and
+// limit(s, v) return false for models without an objective.
+template<class Model, bool maximise>
+class Objective {
+public:
+    static bool value(const Model& s, int& v) {
+        v = s.get_obj_value();
+        return true;
+    }
+    static bool limit(const Model& s, int& v) {
+        v = s.get_obj_bound();
+        return true;
+    }
+    static void bound(Model& s, int v) {
+        s.improve(v);
+    }
+    static bool better(int a, int b) {
+        return maximise ? a > b : a < b;
+    }
+};
+
+template<class Model>
+using Maximise = Objective<Model, true>;
+template<class Model>
+using Minimise = Objective<Model, false>;
+
+// Objective access for satisfaction models
+class NoObjective {
+public:
+    template<class Model>
+    static bool value(const Model&, int&) { return false; }
+    template<class Model>
+    static bool limit(const Model&, int&) { return false; }
+    template<class Model>
+    static void bound(Model&, int) {}
+    static bool better(int, int) { return false; }
+};
+
+// Cutoff sequence of the -restart options, as used by Script::run
+inline Search::Cutoff* cutoff(const Options& opt) {
+    switch (opt.restart()) {
+        case RM_CONSTANT:
+            return Search::Cutoff::constant(opt.restart_scale());
+        case RM_LINEAR:
+            return Search::Cutoff::linear(opt.restart_scale());
+        case RM_LUBY:
+            return Search::Cutoff::luby(opt.restart_scale());
+        case RM_GEOMETRIC:
+            return Search::Cutoff::geometric(opt.restart_scale(), opt.restart_base());
+        default:
+            return NULL;
+    }
+}
+
+// Engine options of -threads, -c_d, -a_d, -nogoods and -restart, and
+// of -time if timed. The stop object of -time, if any, is left to the
+// caller to delete.
+inline Search::Options options(const Options& opt, bool timed = true) {
+    Search::Options so;
+    so.threads = opt.threads();
+    so.c_d = opt.c_d();
+    so.a_d = opt.a_d();
+    so.nogoods_limit = opt.nogoods() ? opt.nogoods_limit() : 0;
+    so.cutoff = cutoff(opt);
+    if (timed && opt.time() > 0)
+        so.stop = new Search::TimeStop(static_cast<unsigned long int>(opt.time()));
+    return so;
+}
+
+// Engine E over root, restart-based if so has a cutoff; root is
+// deleted once the engine has its copy
+template<class Model, template<class> class Engine>
+Search::Base<Model>* engine(Model* root, const Search::Options& so) {
+    Search::Base<Model>* e;
+    if (so.cutoff != NULL)
+        e = new RBS<Model,Engine>(root, so);
+    else
+        e = new Engine<Model>(root, so);
+    delete root;
+    return e;
+}
+
+// How a search run ended
+struct Outcome {
+    unsigned long int solutions;
+    Search::Statistics stat;
+    bool stopped;
+};
+
+// Search with e until it is exhausted or stopped, or until limit
+// solutions are found (0 for all). Every solution is handed over to
+// found(s, statistics), which deletes it and may return false to end
+// the search. A stopped engine may be run again.
+template<class Model, class Found>
+Outcome loop(Search::Base<Model>& e, unsigned long long int limit, Found found) {
+    Outcome o;
+    o.solutions = 0;
+    while (Model* s = e.next()) {
+        o.solutions++;
+        if (!found(s, e.statistics()) || (limit > 0 && o.solutions >= limit))
+            break;
+    }
+    o.stat = e.statistics();
+    o.stopped = e.stopped();
+    return o;
+}
+
+// Print the statistics of a run of ms milliseconds like Script::run
+inline void statistics(std::ostream& os, double ms, unsigned long int solutions,
+                       const Search::Statistics& stat) {
+    os << "\truntime:      " << ms / 1000 << " (" << ms << " ms)" << std::endl
+       << "\tsolutions:    " << solutions << std::endl
+       << "\tpropagations: " << stat.propagate << std::endl
+       << "\tnodes:        " << stat.node << std::endl
+       << "\tfailures:     " << stat.fail << std::endl
+       << "\trestarts:     " << stat.restart << std::endl
+       << "\tpeak depth:   " << stat.depth << std::endl;
+}
+
+}
+
+#endif
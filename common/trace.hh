@@ -0,0 +1,268 @@
+#ifndef __TRACE_HH__
+#define __TRACE_HH__
+
+#include <gecode/int.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+
+using namespace Gecode;
+
+// Search tracer, compiled in with -DDISCOPT_TRACE=ON (see CMakeLists.txt)
+// and free otherwise.
+//
+// The commits of the branchers and the failures of all propagators are
+// recorded as 16 byte events. Commits come from the commit functions
+// below, failures from a Gecode tracer that every model posts with
+// failures(). Every thread fills a chunk taken from a fixed ring of
+// chunks, and full chunks are written by a background thread to the
+// file named by the DISCOPT_TRACE environment variable, search.trace
+// by default. If the writer falls behind, events are dropped and
+// counted rather than stalling search; so are the events left in the
+// chunk of a thread that is still alive at exit, such as the parked
+// threads of a parallel engine.
+// bench/trace_report.cpp turns a trace into a failure-depth histogram
+// and a report of the hot variables.
+//
+// The depth of a node is kept by models deriving from Trace::Depth.
+// Nodes recomputed by the engine are committed, and recorded, again;
+// run with -c_d 1 to record every node once. Forked workers of
+// distributed search are not traced.
+
+namespace Trace {
+
+// Written at the start of a trace file
+const char MAGIC[8] = {'D','O','T','R','A','C','E','1'};
+
+enum {
+    COMMIT, // a brancher committed to alternative alt of var = val
+    FAIL,   // propagator val failed, var is -1
+};
+
+struct Event {
+    uint8_t type;
+    uint8_t alt;
+    uint16_t thread;
+    uint32_t depth;
+    int32_t var;   // position of the variable in its branching
+    int32_t val;
+};
+
+const size_t CHUNK_EVENTS = 4096; // 64 KB per chunk
+const size_t RING_CHUNKS = 64;
+
+struct Chunk {
+    size_t size;
+    Event events[CHUNK_EVENTS];
+};
+
+class Writer {
+protected:
+    std::FILE* file;
+    std::vector<Chunk> ring;
+    std::vector<Chunk*> idle, full;
+    std::mutex m;
+    std::condition_variable cv;
+    std::thread flusher;
+    bool done;
+
+    // Write full chunks until the writer is destroyed
+    void flush(void) {
+        std::unique_lock<std::mutex> l(m);
+        while (true) {
+            cv.wait(l, [this]() { return done || !full.empty(); });
+            if (full.empty())
+                return;
+            Chunk* c = full.front();
+            full.erase(full.begin());
+            l.unlock();
+            (void) std::fwrite(c->events, sizeof(Event), c->size, file);
+            l.lock();
+            idle.push_back(c);
+        }
+    }
+    static void child(void);
+public:
+    std::atomic<bool> off;             // no file, or in a forked child
+    std::atomic<unsigned long> dropped;
+    std::atomic<unsigned int> threads;
+
+    Writer(void) : file(NULL), ring(RING_CHUNKS), done(false),
+                   off(true), dropped(0), threads(0) {
+        const char* name = std::getenv("DISCOPT_TRACE");
+        file = std::fopen(name != NULL ? name : "search.trace", "wb");
+        if (file == NULL) {
+            std::cerr << "cannot open the trace file" << std::endl;
+            return;
+        }
+        (void) std::fwrite(MAGIC, 1, sizeof(MAGIC), file);
+        for (size_t i = 0; i < ring.size(); i++)
+            idle.push_back(&ring[i]);
+        pthread_atfork(NULL, NULL, &Writer::child);
+        flusher = std::thread(&Writer::flush, this);
+        off = false;
+    }
+    ~Writer(void) {
+        if (file == NULL)
+            return;
+        off = true;
+        {
+            std::lock_guard<std::mutex> l(m);
+            done = true;
+            cv.notify_one();
+        }
+        flusher.join();
+        std::fclose(file);
+        // Chunks neither idle nor written are held by live threads
+        for (size_t i = 0; i < ring.size(); i++)
+            if (std::find(idle.begin(), idle.end(), &ring[i]) == idle.end())
+                dropped += ring[i].size;
+        if (dropped > 0)
+            std::cerr << "trace: " << dropped << " events dropped" << std::endl;
+    }
+    // Hand over a chunk c (if any) for writing and take an empty one,
+    // NULL if the ring is used up
+    Chunk* swap(Chunk* c) {
+        std::lock_guard<std::mutex> l(m);
+        if (c != NULL) {
+            full.push_back(c);
+            cv.notify_one();
+        }
+        if (idle.empty())
+            return NULL;
+        Chunk* e = idle.back();
+        idle.pop_back();
+        e->size = 0;
+        return e;
+    }
+};
+
+inline Writer& writer(void) {
+    static Writer w;
+    return w;
+}
+
+inline void Writer::child(void) {
+    writer().off = true;
+}
+
+// Chunk of the current thread, handed over when the thread ends
+struct Local {
+    Chunk* chunk;
+    uint16_t id;
+    Local(void) : chunk(NULL), id(static_cast<uint16_t>(writer().threads++)) {}
+    ~Local(void) {
+        if (chunk != NULL && chunk->size > 0 && !writer().off)
+            (void) writer().swap(chunk);
+    }
+};
+
+inline void record(uint8_t type, unsigned int alt, unsigned int depth, int var, int val) {
+    Writer& w = writer();
+    if (w.off)
+        return;
+    static thread_local Local local;
+    if (local.chunk == NULL || local.chunk->size == CHUNK_EVENTS) {
+        local.chunk = w.swap(local.chunk);
+        if (local.chunk == NULL) {
+            w.dropped++;
+            return;
+        }
+    }
+    Event& e = local.chunk->events[local.chunk->size++];
+    e.type = type;
+    e.alt = static_cast<uint8_t>(alt);
+    e.thread = local.id;
+    e.depth = depth;
+    e.var = var;
+    e.val = val;
+}
+
+// Mixin of the models: the number of commits from the root to this
+// space, copied with the space
+class Depth {
+public:
+    unsigned int depth;
+    Depth(void) : depth(0) {}
+};
+
+#ifdef DISCOPT_TRACE
+// A brancher commits to alternative a of var = val
+inline void commit(Space& home, unsigned int a, int var, int val) {
+    Depth* d = dynamic_cast<Depth*>(&home);
+    record(COMMIT, a, d != NULL ? ++d->depth : 0, var, val);
+}
+#else
+inline void commit(Space&, unsigned int, int, int) {}
+#endif
+
+#if defined(DISCOPT_TRACE) && GECODE_VERSION_NUMBER >= 501000
+// Records the failed propagations of the spaces it is posted on
+class Recorder : public Tracer {
+public:
+    virtual void init(const Space&, const TraceRecorder&) {}
+    virtual void propagate(const Space& home, const TraceRecorder&,
+                           const PropagateTraceInfo& pti) {
+        if (pti.status() != PropagateTraceInfo::FAILED)
+            return;
+        const Depth* d = dynamic_cast<const Depth*>(&home);
+        record(FAIL, 0, d != NULL ? d->depth : 0, -1, static_cast<int>(pti.id()));
+    }
+    virtual void commit(const Space&, const TraceRecorder&, const CommitTraceInfo&) {}
+    virtual void post(const Space&, const TraceRecorder&, const PostTraceInfo&) {}
+    virtual void done(const Space&, const TraceRecorder&) {}
+};
+
+// Record the failures of home and the spaces copied from it
+inline void failures(Home home) {
+    static Recorder recorder;
+    trace(home, TE_PROPAGATE, recorder);
+}
+#else
+// Gecode before 5.1 has no tracer for propagators
+inline void failures(Home) {}
+#endif
+
+// Value and commit functions of INT_VAL for branch()
+inline int valMax(const Space&, IntVar x, int) {
+    return x.max();
+}
+inline void commitVal(Space& home, unsigned int a, IntVar x, int i, int n) {
+    if (a == 0)
+        rel(home, x, IRT_EQ, n);
+    else
+        rel(home, x, IRT_NQ, n);
+    commit(home, a, i, n);
+}
+
+// Commit function for INT_VAL(v, ...), recording the commits when tracing
+inline IntBranchCommit commitHook(void) {
+#ifdef DISCOPT_TRACE
+    return &commitVal;
+#else
+    return IntBranchCommit();
+#endif
+}
+
+// INT_VAL_MAX, recording the commits when tracing
+inline IntValBranch valMaxBranch(void) {
+#ifdef DISCOPT_TRACE
+    return INT_VAL(&valMax, &commitVal);
+#else
+    return INT_VAL_MAX();
+#endif
+}
+
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gecode/driver.hh>
+#include <gecode/int.hh>
+#include <gecode/minimodel.hh>
+
+#include "../common/anytime.hh"
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/dzn.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
+
+using namespace Gecode;
+using namespace std;
+
+// Native model of elephant2.mzn, reading the same data files:
+//   elephant2 data/elephant2_10.dzn
+// As in the MiniZinc model, end is the number of steps in which some
+// guard acts, which are the steps 1..end; at most b - 1 guards are on
+// the boat; and a guard who carries before the last step walks back
+// by the end. With -handout the boat holds b guards, as in the example
+// of the handout, idle steps may come before end, and the plan ends
+// with a carry.
+//
+// act[g,t] is -1 (back to the bank), 0 (wait) or the stones carried.
+// Carrying less than easy[g], or between easy[g] and hard[g], is never
+// better than carrying easy[g] or hard[g], so only those are allowed.
+// What a guard may do next depends on where they are and how long
+// they are still tired, which is a finite automaton; the action
+// sequence of every guard is a regular constraint over it, instead of
+// the disjunctions over all pairs of steps of the MiniZinc model.
+
+
+class elephantOptions : public DriverOptions {
+public:
+    char* filename;
+    Driver::BoolOption _handout;
+
+    elephantOptions(const char* s)
+        : DriverOptions(s, true), filename(NULL),
+          _handout("handout", "the rules of the handout example instead of elephant2.mzn", false) {
+        add(_handout);
+        allow("handout", FLAG);
+    }
+    bool handout(void) const {
+        return _handout.value();
+    }
+
+    void parse(int& argc, char* argv[]) {
+        DriverOptions::parse(argc,argv);
+        if (argc != 2) return;
+        filename = argv[1];
+    }
+};
+
+// Automaton of the actions of a guard. The states are
+//   0         at the bank, may carry
+//   1         on the boat, rested
+//   1+k       on the boat, may not carry for k more steps
+//   1+tired+k at the bank, may not carry for k more steps
+// for k = 1..tired. Every state is final: a guard may stop anywhere.
+DFA guardDFA(int easy, int hard, int tired) {
+    const int bank = 0, boat = 1;
+    vector<DFA::Transition> t;
+    t.push_back(DFA::Transition(bank, 0, bank));
+    if (easy > 0)
+        t.push_back(DFA::Transition(bank, easy, boat));
+    if (hard > easy)
+        t.push_back(DFA::Transition(bank, hard, 1 + tired));
+    t.push_back(DFA::Transition(boat, 0, boat));
+    t.push_back(DFA::Transition(boat, -1, bank));
+    for (int k = 1; k <= tired; k ++){
+        int onBoat = 1 + k, atBank = 1 + tired + k;
+        t.push_back(DFA::Transition(onBoat, 0, k > 1 ? onBoat - 1 : boat));
+        t.push_back(DFA::Transition(onBoat, -1, k > 1 ? atBank - 1 : bank));
+        t.push_back(DFA::Transition(atBank, 0, k > 1 ? atBank - 1 : bank));
+    }
+    t.push_back(DFA::Transition(-1, 0, 0));
+    vector<int> f;
+    for (int s = 0; s <= 1 + 2 * tired; s ++)
+        f.push_back(s);
+    f.push_back(-1);
+    return DFA(bank, &t[0], &f[0]);
+}
+
+
+class Elephant : public Script, public Trace::Depth {
+protected:
+    int T; // Number of steps
+    int G; // Number of guards
+
+    // act[t*G + g]: the action of guard g at step t, step major
+    IntVarArray act;
+    IntVar end;
+
+public:
+    Elephant(const elephantOptions& opt) : Script(opt) {
+        Trace::failures(*this);
+        Dzn data(opt.filename, opt.request());
+        T = data.integer("T");
+        G = data.integer("G");
+        int E = data.integer("E");
+        int p = data.integer("p");
+        int b = data.integer("b");
+        vector<int> easy = data.array("easy");
+        vector<int> hard = data.array("hard");
+        vector<int> tired = data.array("tired");
+        if (T < 1 || G < 1)
+            data.error("T and G must be positive");
+        if (static_cast<int>(easy.size()) != G || static_cast<int>(hard.size()) != G ||
+            static_cast<int>(tired.size()) != G)
+            data.error("easy, hard and tired must list G guards");
+
+        act = IntVarArray(*this, T*G, -1, E);
+        end = IntVar(*this, 1, T);
+        Matrix<IntVarArray> a(act, G, T);
+
+        for (int g = 0; g < G; g ++)
+            extensional(*this, a.col(g), guardDFA(easy[g], hard[g], tired[g]));
+
+        // onb[t*G + g]: guard g is on the boat after step t
+        BoolVarArgs onb(*this, T*G, 0, 1);
+        Matrix<BoolVarArgs> o(onb, G, T);
+        // Stones carried; a return is -1 and counted back
+        LinIntExpr stones(0);
+        for (int t = 0; t < T; t ++){
+            BoolVarArgs moving, carrying, returning;
+            for (int g = 0; g < G; g ++){
+                moving << expr(*this, a(g,t) != 0);
+                carrying << expr(*this, a(g,t) > 0);
+                returning << expr(*this, a(g,t) == -1);
+                if (t == 0)
+                    rel(*this, o(g,t) == carrying[g]);
+                else
+                    rel(*this, o(g,t) == o(g,t-1) + carrying[g] - returning[g]);
+                stones = stones + a(g,t) + returning[g];
+            }
+            // The pier, all in the same direction
+            linear(*this, moving, IRT_LQ, p);
+            BoolVar toBoat(*this, 0, 1);
+            for (int g = 0; g < G; g ++){
+                rel(*this, carrying[g] >> toBoat);
+                rel(*this, returning[g] >> !toBoat);
+            }
+            // Fewer than b guards on the boat, at most b with -handout
+            linear(*this, o.row(t), opt.handout() ? IRT_LQ : IRT_LE, b);
+
+            // Everyone waits after the end
+            BoolVar active = expr(*this, end >= t + 1);
+            for (int g = 0; g < G; g ++)
+                rel(*this, moving[g] >> active);
+            BoolVar last = expr(*this, end == t + 1);
+            if (opt.handout()) {
+                // The plan ends with a carry
+                clause(*this, BOT_OR, carrying, BoolVarArgs() << last, 1);
+            } else {
+                // Some guard acts in every step up to the end, the
+                // first one included
+                clause(*this, BOT_OR, moving, BoolVarArgs() << active, 1);
+                // Only who carries in the last step stays on the boat
+                for (int g = 0; g < G; g ++)
+                    clause(*this, BOT_OR, BoolVarArgs() << carrying[g],
+                           BoolVarArgs() << last << o(g,t), 1);
+            }
+        }
+        rel(*this, stones >= E);
+
+        // The shortest plans first
+        branch(*this, end, INT_VAL_MIN());
+        branchHeuristic(*this, act, opt);
+    }
+
+    // The output of elephant2.mzn
+    virtual void print(std::ostream& os) const {
+        os << "act = array2d(GUARD,TIME,[\n";
+        for (int g = 0; g < G; g ++){
+            for (int t = 0; t < T; t ++){
+                os << setw(2) << act[t*G + g].val() << ",\t";
+                if (t == T-1 && g == G-1)
+                    os << "]);\n";
+                else if (t == T-1)
+                    os << "\n";
+            }
+        }
+        os << "end =" << setw(2) << end.val() << ";" << endl;
+    }
+
+    Elephant(SHARE_PARAM Elephant& s)
+        : Script(SHARE_ARG s), Trace::Depth(s), T(s.T), G(s.G) {
+        act.update(*this, SHARE_ARG s.act);
+        end.update(*this, SHARE_ARG s.end);
+    }
+
+    virtual Space* copy(SHARE_VOID) {
+        return new Elephant(SHARE_ARG *this);
+    }
+
+    int get_obj_value() const{
+        return end.val();
+    }
+
+    int get_obj_bound() const{
+        return end.min();
+    }
+
+    virtual void constrain(const Space& _best) {
+        improve(static_cast<const Elephant&>(_best).get_obj_value());
+    }
+
+    void improve(int v) {
+        rel(*this, end < v);
+    }
+};
+
+void parseOptions(elephantOptions& opt, int& argc, char* argv[]) {
+    opt.parse(argc, argv);
+    opt.solutions(0);
+}
+
+// Solve one service request
+bool serveElephant(int argc, char* argv[], ostream& os) {
+    elephantOptions opt("Elephant 2");
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (opt.filename == NULL)
+        throw Exception("elephant2", "no data file");
+    return Service::solve<Elephant, BAB, elephantOptions>(opt, os);
+}
+
+#ifndef DRIVER_NO_MAIN
+int main(int argc, char* argv[]) {
+    elephantOptions opt("Elephant 2");
+    parseOptions(opt, argc, argv);
+
+    if (opt.service()[0] != '\0')
+        return Service::serve(opt.service(), Service::threads(opt), serveElephant);
+    else if (opt.filename == NULL) {
+        cerr << "usage: " << argv[0] << " [options] data.dzn\n";
+        return 1;
+    } else if (opt.processes() > 0)
+        Distributed::run<Elephant, BAB, Solve::Minimise<Elephant>>(opt, opt.processes());
+    else if (opt.anytime()[0] != '\0')
+        Anytime::run<Elephant, Solve::Minimise<Elephant>>(opt, opt.anytime());
+    else
+        Script::run<Elephant, BAB, elephantOptions>(opt);
+
+    return 0;
+}
+#endif
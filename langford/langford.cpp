@@ -2,6 +2,18 @@
 #include <gecode/int.hh>
 #include <gecode/minimodel.hh>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
+
 using namespace Gecode;
 using namespace std;
 
@@ -28,15 +40,136 @@ int* decodeAsY(vector<int> y, int n, int k){
     return result;
 }
 
-class LangfordOptions : public Options {
+// Enumeration of Langford sequences L(k,n) with bit masks, an
+// alternative to the constraint models for exhaustive counts.
+// Position p of the sequence is bit p of a mask of n*k <= 64 bits.
+// The k occurrences of number i+1 are i+2 apart, so they form the bit
+// pattern pattern[i] shifted by the position of the first one. The
+// numbers are placed from the largest to the smallest. By reversal
+// symmetry the largest number is only placed in the left half, and
+// sequences with it left of the centre are counted twice.
+class LangfordBits {
+protected:
+    int n, k, len;
+    vector<unsigned long long> pattern;
+    // Last possible first position of number i+1
+    int last(int i) const {
+        return len - 1 - (k-1)*(i+2);
+    }
+    // Number of ways to place the numbers 1..i+1 into the free bits of mask
+    unsigned long long countFrom(int i, unsigned long long mask) const {
+        if (i < 0)
+            return 1;
+        unsigned long long count = 0;
+        for (int p = 0; p <= last(i); p ++)
+            if ((mask & (pattern[i] << p)) == 0)
+                count += countFrom(i-1, mask | (pattern[i] << p));
+        return count;
+    }
+    // Weight of a first position p of the largest number:
+    // 2 left of the centre, 1 on it and 0 right of it
+    int weight(int p) const {
+        int mirror = last(n-1) - p;
+        return p < mirror ? 2 : (p == mirror ? 1 : 0);
+    }
+    // Enumerate the placements of the numbers 1..i+1 into mask,
+    // x[i*k+j] holding the 1-based position of the jth occurrence
+    void enumerate(int i, unsigned long long mask, int w, vector<int>& x,
+                   ostream& os, unsigned long long& found,
+                   unsigned long long limit) const {
+        if (limit > 0 && found >= limit)
+            return;
+        if (i < 0) {
+            printX(os, x);
+            found ++;
+            if (w == 2 && (limit == 0 || found < limit)) {
+                vector<int> r(n*k);
+                for (int v = 0; v < n; v ++)
+                    for (int j = 0; j < k; j ++)
+                        r[v*k+j] = len + 1 - x[v*k + k-1-j];
+                printX(os, r);
+                found ++;
+            }
+            return;
+        }
+        for (int p = 0; p <= last(i); p ++) {
+            int pw = i == n-1 ? weight(p) : w;
+            if (pw == 0 || (mask & (pattern[i] << p)) != 0)
+                continue;
+            for (int j = 0; j < k; j ++)
+                x[i*k+j] = p + j*(i+2) + 1;
+            enumerate(i-1, mask | (pattern[i] << p), pw, x, os, found, limit);
+        }
+    }
+    void printX(ostream& os, const vector<int>& x) const {
+        int* result = decodeAsX(x, n, k);
+        for (int i = 0; i < n*k; i ++)
+            os << result[i] << " ";
+        os << endl;
+        delete [] result;
+    }
+public:
+    LangfordBits(int n0, int k0) : n(n0), k(k0), len(n0*k0), pattern(n0) {
+        // A number spanning more than len positions cannot be placed,
+        // last() is negative for it, and keeps an empty pattern
+        for (int i = 0; i < n; i ++)
+            if ((k-1)*(i+2) < len && (k-1)*(i+2) < 64)
+                for (int j = 0; j < k; j ++)
+                    pattern[i] |= 1ULL << (j*(i+2));
+    }
+    // Whether the sequence fits into the 64 bits of a mask
+    bool fits(void) const {
+        return len <= 64;
+    }
+    // Count all sequences with the given number of threads, sharing
+    // out the placements of the two largest numbers
+    unsigned long long count(unsigned int threads) const {
+        // mask after placing the largest numbers, and its weight
+        vector<pair<unsigned long long,int> > tasks;
+        for (int p = 0; p <= last(n-1); p ++) {
+            if (weight(p) == 0) continue;
+            unsigned long long m0 = pattern[n-1] << p;
+            if (n == 1) {
+                tasks.push_back(make_pair(m0, weight(p)));
+                continue;
+            }
+            for (int q = 0; q <= last(n-2); q ++)
+                if ((m0 & (pattern[n-2] << q)) == 0)
+                    tasks.push_back(make_pair(m0 | (pattern[n-2] << q), weight(p)));
+        }
+        atomic<unsigned int> next(0);
+        atomic<unsigned long long> total(0);
+        vector<thread> pool;
+        for (unsigned int t = 0; t < max(threads, 1u); t ++)
+            pool.push_back(thread([&]() {
+                unsigned long long count = 0;
+                for (unsigned int i = next++; i < tasks.size(); i = next++)
+                    count += tasks[i].second * countFrom(n-3, tasks[i].first);
+                total += count;
+            }));
+        for (unsigned int t = 0; t < pool.size(); t ++)
+            pool[t].join();
+        return total;
+    }
+    // Print up to limit sequences (0 for all) like Langford::print;
+    // returns how many were printed
+    unsigned long long print(ostream& os, unsigned long long limit) const {
+        vector<int> x(n*k);
+        unsigned long long found = 0;
+        enumerate(n-1, 0, 1, x, os, found, limit);
+        return found;
+    }
+};
+
+
+class LangfordOptions : public DriverOptions {
 public:
     int n, k;
 
-    LangfordOptions(const char* s, int n0, int k0)
-        : Options(s), n(n0), k(k0) {}
+    LangfordOptions(const char* s, int n0, int k0) : DriverOptions(s), n(n0), k(k0) {}
 
     void parse(int& argc, char* argv[]) {
-        Options::parse(argc,argv);
+        DriverOptions::parse(argc,argv);
         if (argc < 3) return;
         n = atoi(argv[1]);
         k = atoi(argv[2]);
@@ -44,7 +177,7 @@ public:
 };
 
 
-class Langford : public Script {
+class Langford : public Script, public Trace::Depth {
 protected:
     int k, n;      
     IntVarArray x;
@@ -55,12 +188,14 @@ public:
     MODEL_TWO,
     MODEL_CHANNEL,
     MODEL_SYM,
+    MODEL_BITS,    // enumerate with LangfordBits, see main
     SEARCH_ONE,
     SEARCH_TWO,
     SEARCH_THREE,
     };
 
     Langford(const LangfordOptions& opt): Script(opt), k(opt.k), n(opt.n) {
+        Trace::failures(*this);
         opt_num = opt.model();
         switch (opt.model()) {
             ///////////////////////////////////////////////////////////////
@@ -70,7 +205,7 @@ public:
             // j ∈ {0, . . . , k −1}, denotes the position where the jth 
             // occurrence of the number i + 1 appears in the sequence.
             case MODEL_ONE: { 
-                cout << "solve using model 1\n";
+                opt.messages() << "solve using model 1\n";
                 x = IntVarArray(*this, k*n, 1, k*n);
                 distinct(*this, x, IPL_DOM);
                 for (int i = 0; i < n; i ++){
@@ -78,13 +213,13 @@ public:
                         rel(*this, x[i*k+j+1] == x[i*k+j]+i+2);
                     }
                 }
-                branch(*this, x, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                branchHeuristic(*this, x, opt);
             } break;
             ///////////////////////////////////////////////////////////////
             ///////////////////////  Model  2 /////////////////////////////
             ///////////////////////////////////////////////////////////////
             case MODEL_TWO: {
-                cout << "solve using model 2\n";
+                opt.messages() << "solve using model 2\n";
                 x = IntVarArray(*this, k*n, 0, k*n-1);
                 distinct(*this, x, IPL_DOM);
                 for (int i = 0; i < n; i ++){
@@ -99,13 +234,13 @@ public:
                         rel(*this, x[j-1] != i*k);
                     }
                 }
-                branch(*this, x, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                branchHeuristic(*this, x, opt);
             } break;
             ///////////////////////////////////////////////////////////////
             /////////////////  Channeling Model 1 and 2 ///////////////////
             ///////////////////////////////////////////////////////////////
             case MODEL_CHANNEL: {
-                cout << "solve using model channel\n";
+                opt.messages() << "solve using model channel\n";
                 x = IntVarArray(*this,k*n,1,k*n);
                 IntVarArray y = IntVarArray(*this,k*n,0,k*n-1);
                 // channeling
@@ -135,16 +270,16 @@ public:
                 // Define different search methods
                 switch (opt.search()){
                     case SEARCH_ONE: {
-                        cout << "solve using search one\n";
-                        branch(*this, x, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search one\n";
+                        branchHeuristic(*this, x, opt);
                     }  break;
                     case SEARCH_TWO: {
-                        cout << "solve using search two\n";
-                        branch(*this, y, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search two\n";
+                        branchHeuristic(*this, y, opt);
                     } break;
                     case SEARCH_THREE: {
-                        cout << "solve using search three\n";
-                        branch(*this, x+y, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search three\n";
+                        branchHeuristic(*this, x+y, opt);
                     } break;
                 }
             } break;
@@ -152,7 +287,7 @@ public:
             ///// Channeling Model 1 and 2 with symmetric breaking/////////
             ///////////////////////////////////////////////////////////////
             case MODEL_SYM: {
-                cout << "solve using model channel with symmetric breaking\n";
+                opt.messages() << "solve using model channel with symmetric breaking\n";
                 x = IntVarArray(*this,k*n,1,k*n);
                 IntVarArray y = IntVarArray(*this,k*n,0,k*n-1);
                 // channeling
@@ -184,16 +319,16 @@ public:
                 // Define different search methods
                 switch (opt.search()){
                     case SEARCH_ONE: {
-                        cout << "solve using search one\n";
-                        branch(*this, x, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search one\n";
+                        branchHeuristic(*this, x, opt);
                     }  break;
                     case SEARCH_TWO: {
-                        cout << "solve using search two\n";
-                        branch(*this, y, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search two\n";
+                        branchHeuristic(*this, y, opt);
                     } break;
                     case SEARCH_THREE: {
-                        cout << "solve using search three\n";
-                        branch(*this, x+y, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+                        opt.messages() << "solve using search three\n";
+                        branchHeuristic(*this, x+y, opt);
                     } break;
                 }
             } break;
@@ -219,36 +354,93 @@ public:
         os << endl;
     }
 
-    Langford(bool share, Langford& l): Script(share, l) {
+    Langford(SHARE_PARAM Langford& l): Script(SHARE_ARG l), Trace::Depth(l) {
         opt_num = l.opt_num;
         k = l.k;
         n = l.n;
-        x.update(*this, share, l.x);
+        x.update(*this, SHARE_ARG l.x);
     }
     
-    virtual Space* copy(bool share) {
-        return new Langford(share, *this);
+    virtual Space* copy(SHARE_VOID) {
+        return new Langford(SHARE_ARG *this);
     }
 };
 
-int main(int argc, char* argv[]) {
-    LangfordOptions opt("Langford",9,3);
+// Count or print the sequences with LangfordBits, for model 5
+void runBits(const LangfordOptions& opt, unsigned int threads, ostream& os) {
+    LangfordBits bits(opt.n, opt.k);
+    Support::Timer t;
+    t.start();
+    // Only count with -mode stat, otherwise print the sequences
+    unsigned long long count = opt.mode() == SM_STAT ?
+        bits.count(threads) : bits.print(os, opt.solutions());
+    double ms = t.stop();
+    os << "L(" << opt.k << "," << opt.n << "): " << count << " solutions" << endl
+       << "\truntime:      " << ms / 1000 << " (" << ms << " ms)" << endl;
+}
+
+void parseOptions(LangfordOptions& opt, int& argc, char* argv[]) {
     opt.model(Langford::MODEL_CHANNEL);
     opt.model(Langford::MODEL_ONE, "1");
     opt.model(Langford::MODEL_TWO, "2");
     opt.model(Langford::MODEL_CHANNEL, "3");
     opt.model(Langford::MODEL_SYM, "4");
+    opt.model(Langford::MODEL_BITS, "5", "enumerate with bit masks");
 
     opt.search(Langford::SEARCH_THREE);
     opt.search(Langford::SEARCH_ONE, "1");
     opt.search(Langford::SEARCH_TWO, "2");
     opt.search(Langford::SEARCH_THREE, "3");
 
+    opt.restartDefaults();
     opt.parse(argc, argv);
-    opt.solutions(0);
+    opt.restartSolutions();
+}
 
-    Script::run<Langford, DFS, LangfordOptions>(opt);
+// Why L(k,n) cannot be solved with opt, or NULL. The positions
+// 1..n*k are numbered in an int.
+const char* sizeError(const LangfordOptions& opt) {
+    if (opt.n < 1 || opt.k < 1)
+        return "n and k must be at least 1";
+    if (opt.n > 46340 / opt.k)
+        return "n*k is too large";
+    if (opt.model() == Langford::MODEL_BITS && !LangfordBits(opt.n, opt.k).fits())
+        return "model 5 requires n*k <= 64";
+    return NULL;
+}
 
-    return 0;
+// Solve one service request
+bool serveLangford(int argc, char* argv[], ostream& os) {
+    LangfordOptions opt("Langford",9,3);
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (const char* error = sizeError(opt))
+        throw Exception("Langford", error);
+    if (opt.model() != Langford::MODEL_BITS)
+        return Service::solve<Langford, DFS, LangfordOptions>(opt, os);
+    runBits(opt, Service::threads(opt), os);
+    return true;
 }
 
+// bench/bench.cpp includes the model with DRIVER_NO_MAIN defined.
+#ifndef DRIVER_NO_MAIN
+int main(int argc, char* argv[]) {
+    LangfordOptions opt("Langford",9,3);
+    parseOptions(opt, argc, argv);
+
+    if (opt.service()[0] != '\0')
+        return Service::serve(opt.service(), Service::threads(opt), serveLangford);
+    else if (const char* error = sizeError(opt)) {
+        cerr << argv[0] << ": " << error << endl;
+        return 1;
+    } else if (opt.model() == Langford::MODEL_BITS) {
+        // Threads of the counting engine, 0 for one per core
+        runBits(opt, Service::threads(opt), cout);
+    } else if (opt.processes() > 0)
+        Distributed::run<Langford, DFS, Solve::NoObjective>(opt, opt.processes());
+    else
+        Script::run<Langford, DFS, LangfordOptions>(opt);
+
+    return 0;
+}
+#endif
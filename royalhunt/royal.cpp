@@ -1,6 +1,8 @@
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <stdlib.h>
 
@@ -8,6 +10,15 @@
 #include <gecode/int.hh>
 #include <gecode/minimodel.hh>
 
+#include "../common/anytime.hh"
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/memory.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
+
 using namespace Gecode;
 using namespace std;
 
@@ -44,6 +55,8 @@ void split(const string& src, const string& separator, vector<string>& dest)
 
  * The name of the data file should be passed to filename
  * The enjoy values are put in an one-dimentional array
+ * Errors in the data end the process, or throw if throws is set, as
+ * in service requests
  */
 void readData(char filename[], 
               int &n, int &m, 
@@ -51,24 +64,33 @@ void readData(char filename[],
               vector<int> &ability, 
               vector<int> &beauty, 
               vector<int> &speed, 
-              vector<int> &enjoy){
+              vector<int> &enjoy,
+              bool throws = false){
+    auto error = [&](const string& message) {
+        if (throws)
+            throw runtime_error(string(filename) + ": " + message);
+        cout << message << "\n";
+        exit(0);
+    };
     ifstream inputFile(filename);
 
-    if (!inputFile.is_open()){
-        cout << "input file does not exists!\n";
-        exit(0);
-    }
+    if (!inputFile.is_open())
+        error("input file does not exists!");
 
     string line;
 
     // read n
     getline(inputFile, line);
     n = atoi(line.c_str());
+    if (n < 1)
+        error("there must be at least one rider");
 
     // rank
     getline(inputFile, line);
     vector<string> ranks;
     split(line, " ", ranks);
+    if (static_cast<int>(ranks.size()) < n)
+        error("missing ranks");
     for (int rider = 0; rider < n; rider++){
         rank.push_back(atoi(ranks[rider].c_str()));
     }
@@ -77,6 +99,8 @@ void readData(char filename[],
     getline(inputFile, line);
     vector<string> abilities;
     split(line, " ", abilities);
+    if (static_cast<int>(abilities.size()) < n)
+        error("missing abilities");
     for (int rider = 0; rider < n; rider++){
         ability.push_back(atoi(abilities[rider].c_str()));
     }
@@ -84,11 +108,15 @@ void readData(char filename[],
     // read m
     getline(inputFile, line);
     m = atoi(line.c_str());
+    if (m < 1)
+        error("there must be at least one horse");
 
     // beauty
     getline(inputFile, line);
     vector<string> beauties;
     split(line, " ", beauties);
+    if (static_cast<int>(beauties.size()) < m)
+        error("missing beauties");
     for (int horse = 0; horse < m; horse++){
         beauty.push_back(atoi(beauties[horse].c_str()));
     }
@@ -97,6 +125,8 @@ void readData(char filename[],
     getline(inputFile, line);
     vector<string> speeds;
     split(line, " ", speeds);
+    if (static_cast<int>(speeds.size()) < m)
+        error("missing speeds");
     for (int horse = 0; horse < m; horse++){
         speed.push_back(atoi(speeds[horse].c_str()));
     }
@@ -107,6 +137,8 @@ void readData(char filename[],
         enjoy_values.clear();
         getline(inputFile, line);
         split(line, " ", enjoy_values);
+        if (static_cast<int>(enjoy_values.size()) < m)
+            error("missing enjoyments");
         for (int horse = 0; horse < m; horse++){
             enjoy.push_back(atoi(enjoy_values[horse].c_str()));
         }
@@ -157,23 +189,78 @@ void cleanData(int &n, int &m, int & nD,
     }
 }
 
+// This function reads a previous assignment for a warm start, either a
+// single line as written by royalhunt::print or the whole output of an
+// earlier run, whose last assignment is its best one.
+// warm[i] is the horse of the ith court member, -1 if he/she did not
+// ride, and -2 if his/her horse is no longer available.
+// Returns false if the file holds no assignment of n court members.
+bool readWarm(const char* filename, int n, int m, vector<int> &warm){
+    ifstream inputFile(filename);
+    string line;
+    bool found = false, objective = false;
+    while (getline(inputFile, line)){
+        // Skip the objective value printed after every assignment
+        if (objective){
+            objective = false;
+            continue;
+        }
+        istringstream is(line);
+        vector<int> horses;
+        int h;
+        while (is >> h)
+            horses.push_back(h);
+        if (!is.eof() || static_cast<int>(horses.size()) != n)
+            continue;
+        // Horses are printed 1-based, 0 stands for no horse
+        warm.assign(n, -2);
+        for (int i = 0; i < n; i ++)
+            if (horses[i] == 0)
+                warm[i] = -1;
+            else if (horses[i] >= 1 && horses[i] <= m)
+                warm[i] = horses[i] - 1;
+        found = objective = true;
+    }
+    return found;
+}
+
 
-class royalhuntOptions : public Options {
+class royalhuntOptions : public DriverOptions {
 public:
     char* filename;
+    // Objective of the completed -warm assignment, set by main before
+    // the run; only solutions at least as good are searched for then
+    bool warmed;
+    int warmObjective;
+    Driver::StringValueOption _warm;
+    Driver::UnsignedIntOption _memory;
 
     royalhuntOptions(const char* s)
-        : Options(s) {}
+        : DriverOptions(s, true), filename(NULL), warmed(false), warmObjective(0),
+          _warm("warm", "previous assignment to start from (file)", ""),
+          _memory("memory", "memory limit in MB, keeping only the best solution (0 for none)", 0) {
+        add(_warm);
+        add(_memory);
+    }
+    const char* warm(void) const {
+        return _warm.value();
+    }
+    unsigned int memory(void) const {
+        return _memory.value();
+    }
 
     void parse(int& argc, char* argv[]) {
-        Options::parse(argc,argv);
+        DriverOptions::parse(argc,argv);
+        exclusive(memory() > 0, "memory", processes() > 0, "processes");
+        exclusive(memory() > 0, "memory", service()[0] != '\0', "service");
+        exclusive(warm()[0] != '\0', "warm", service()[0] != '\0', "service");
         if (argc != 2) return;
         filename = argv[1];
     }
 };
 
 
-class royalhunt : public Script {
+class royalhunt : public Script, public Trace::Depth {
 protected:
     int n; // Number of court members
     int m; // Number of horse
@@ -210,9 +297,53 @@ protected:
     BoolVarArray helper3;
     BoolVarArray helper4;
 
+    // The previous assignment given with -warm, see readWarm
+    vector<int> warm;
+
+    // Branching value: the previous horse while it is still possible,
+    // otherwise the largest horse like INT_VAL_MAX
+    static int warmVal(const Space& home, IntVar x, int i) {
+        const vector<int>& w = static_cast<const royalhunt&>(home).warm;
+        if (i < static_cast<int>(w.size()) && w[i] >= 0 && x.in(w[i]))
+            return w[i];
+        return x.max();
+    }
+
 public:
+    // Complete the previous assignment under the current data; returns
+    // whether it can be completed, with its best objective in v. The
+    // root of a run that only allows solutions at least as good is led
+    // back to the previous assignment first by the branching, and only
+    // the changed parts of the roster are explored to improve on it.
+    bool warmStart(int& v) {
+        if (warm.empty() || status() == SS_FAILED)
+            return false;
+        royalhunt* c = static_cast<royalhunt*>(clone());
+        for (int i = 0; i < n; i ++)
+            if (warm[i] >= 0)
+                rel(*c, c->p2h[i] == warm[i]);
+            else if (warm[i] == -1)
+                rel(*c, c->p2h[i] >= m);
+        BAB<royalhunt> e(c);
+        delete c;
+        royalhunt* best = NULL;
+        while (royalhunt* s = e.next()) {
+            delete best;
+            best = s;
+        }
+        if (best == NULL) {
+            cout << "warm start: previous assignment is infeasible\n";
+            return false;
+        }
+        v = best->get_obj_value();
+        cout << "warm start: previous objective " << v << "\n";
+        delete best;
+        return true;
+    }
+
     royalhunt(const royalhuntOptions& opt): Script(opt){
-        readData(opt.filename, n, m, rank, ability, beauty, speed, enjoy);
+        Trace::failures(*this);
+        readData(opt.filename, n, m, rank, ability, beauty, speed, enjoy, opt.request());
         cleanData(n, m, nD, rank, ability, beauty, speed, enjoy);
 
         // Find max ability, beauty, enjoy, and speed
@@ -239,7 +370,17 @@ public:
         helper2 = BoolVarArray(*this, nD*nD, 0, 1); 
         helper3 = BoolVarArray(*this, nD*nD, 0, 1); 
         helper4 = BoolVarArray(*this, nD*nD, 0, 1); 
-        Obj_val = IntVar(*this, -10000, 10000);
+        // Bounds of the objective from the data: at most the best enjoy
+        // of everyone, at least no enjoy and a penalty for every pair of
+        // horses where one is faster
+        int maxObj = 0, penalties = 0;
+        for (int i = 0; i < nD; i ++)
+            maxObj += *max_element(enjoy.begin() + i*nD, enjoy.begin() + (i+1)*nD);
+        for (int h1 = 0; h1 < nD; h1 ++)
+            for (int h2 = 0; h2 < nD; h2 ++)
+                if (h1 <= m && h2 <= m && speed[h1] > speed[h2])
+                    penalties ++;
+        Obj_val = IntVar(*this, -100 * penalties, maxObj);
 
         // Define those cur_ stuff
         for (int i = 0; i < nD; i ++){
@@ -351,7 +492,22 @@ public:
             }
         }
 
-        branch(*this, p2h, INT_VAR_SIZE_MIN(), INT_VAL_MAX());
+        if (opt.warm()[0] == '\0') {
+            branchHeuristic(*this, p2h, opt);
+        } else if (!readWarm(opt.warm(), n, m, warm)) {
+            opt.messages() << "warm start: no assignment in " << opt.warm() << "\n";
+            branchHeuristic(*this, p2h, opt);
+        } else if (opt.branching() == BRANCH_MED) {
+            // The median split has no value to bias, so the smallest
+            // domain is branched on with the previous horse instead
+            opt.messages() << "warm start: -branching med tries the previous horse first"
+                 << " instead of the median\n";
+            branch(*this, p2h, INT_VAR_SIZE_MIN(), INT_VAL(&warmVal, Trace::commitHook()));
+        } else {
+            branchHeuristic(*this, p2h, opt, INT_VAL(&warmVal, Trace::commitHook()));
+        }
+        if (opt.warmed)
+            rel(*this, Obj_val >= opt.warmObjective);
     }
     
     virtual void print(std::ostream& os) const {
@@ -365,7 +521,7 @@ public:
         os << Obj_val << endl;
     }
 
-    royalhunt(bool share, royalhunt& oldR): Script(share, oldR) {
+    royalhunt(SHARE_PARAM royalhunt& oldR): Script(SHARE_ARG oldR), Trace::Depth(oldR) {
         n = oldR.n;
         m = oldR.m;
         nD = oldR.nD;
@@ -381,43 +537,89 @@ public:
         for(unsigned i = 0; i < oldR.enjoy.size(); i++)
             enjoy.push_back(oldR.enjoy[i]);
 
-        p2h.update(*this, share, oldR.p2h);
-        h2p.update(*this, share, oldR.h2p);
-        cur_enjoy.update(*this, share, oldR.cur_enjoy);
-        cur_beauty.update(*this, share, oldR.cur_beauty);
-        cur_ability.update(*this, share, oldR.cur_ability);
-        cur_speed.update(*this, share, oldR.cur_speed);
-        cur_penalty.update(*this, share, oldR.cur_penalty);
-        helper1.update(*this, share, oldR.helper1);
-        helper2.update(*this, share, oldR.helper2);
-        helper3.update(*this, share, oldR.helper3);
-        helper4.update(*this, share, oldR.helper4);
-        Obj_val.update(*this, share, oldR.Obj_val);
+        p2h.update(*this, SHARE_ARG oldR.p2h);
+        h2p.update(*this, SHARE_ARG oldR.h2p);
+        cur_enjoy.update(*this, SHARE_ARG oldR.cur_enjoy);
+        cur_beauty.update(*this, SHARE_ARG oldR.cur_beauty);
+        cur_ability.update(*this, SHARE_ARG oldR.cur_ability);
+        cur_speed.update(*this, SHARE_ARG oldR.cur_speed);
+        cur_penalty.update(*this, SHARE_ARG oldR.cur_penalty);
+        helper1.update(*this, SHARE_ARG oldR.helper1);
+        helper2.update(*this, SHARE_ARG oldR.helper2);
+        helper3.update(*this, SHARE_ARG oldR.helper3);
+        helper4.update(*this, SHARE_ARG oldR.helper4);
+        Obj_val.update(*this, SHARE_ARG oldR.Obj_val);
+        warm = oldR.warm;
     }
     
-    virtual Space* copy(bool share) {
-        return new royalhunt(share, *this);
+    virtual Space* copy(SHARE_VOID) {
+        return new royalhunt(SHARE_ARG *this);
     }
 
     int get_obj_value() const{
         return Obj_val.val();
     }
 
+    int get_obj_bound() const{
+        return Obj_val.max();
+    }
+
     virtual void constrain(const Space& _best) {
         const royalhunt& prev_best = static_cast<const royalhunt&>(_best);
-        rel(*this, Obj_val > prev_best.get_obj_value());
+        improve(prev_best.get_obj_value());
+    }
+
+    void improve(int v) {
+        rel(*this, Obj_val > v);
     }
 
 };
 
+void parseOptions(royalhuntOptions& opt, int& argc, char* argv[]) {
+    opt.ipl(IPL_DOM);
+    opt.parse(argc, argv);
+    opt.solutions(0);
+}
+
+// Solve one service request
+bool serveRoyalhunt(int argc, char* argv[], ostream& os) {
+    royalhuntOptions opt("Royal Hunt");
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (opt.filename == NULL)
+        throw Exception("royalhunt", "no data file");
+    return Service::solve<royalhunt, BAB, royalhuntOptions>(opt, os);
+}
+
+// Bound the run by the completed -warm assignment. Only the root of
+// the command line run does this: service requests and the bench keep
+// just the value order of the warm start.
+void warmStart(royalhuntOptions& opt) {
+    royalhunt* r = new royalhunt(opt);
+    opt.warmed = r->warmStart(opt.warmObjective);
+    delete r;
+}
 
+// bench/bench.cpp includes the model with DRIVER_NO_MAIN defined.
+#ifndef DRIVER_NO_MAIN
 int main(int argc, char* argv[]) {
     royalhuntOptions rOpt("Royal Hunt");
-    rOpt.ipl(IPL_DOM);
-    rOpt.parse(argc, argv);
-    rOpt.solutions(0);
-
-    Script::run<royalhunt, BAB, royalhuntOptions>(rOpt);
+    parseOptions(rOpt, argc, argv);
+
+    if (rOpt.service()[0] != '\0')
+        return Service::serve(rOpt.service(), Service::threads(rOpt), serveRoyalhunt);
+    if (rOpt.warm()[0] != '\0')
+        warmStart(rOpt);
+    if (rOpt.processes() > 0)
+        Distributed::run<royalhunt, BAB, Solve::Maximise<royalhunt>>(rOpt, rOpt.processes());
+    else if (rOpt.memory() > 0)
+        Memory::run<royalhunt, Solve::Maximise<royalhunt>>(rOpt, rOpt.memory(),
+            rOpt.anytime()[0] != '\0' ? rOpt.anytime() : NULL);
+    else if (rOpt.anytime()[0] != '\0')
+        Anytime::run<royalhunt, Solve::Maximise<royalhunt>>(rOpt, rOpt.anytime());
+    else
+        Script::run<royalhunt, BAB, royalhuntOptions>(rOpt);
 
     return 0;
 }
+#endif
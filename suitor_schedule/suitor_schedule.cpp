@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gecode/driver.hh>
+#include <gecode/int.hh>
+#include <gecode/minimodel.hh>
+
+#include "../common/anytime.hh"
+#include "../common/branching.hh"
+#include "../common/compat.hh"
+#include "../common/distributed.hh"
+#include "../common/dzn.hh"
+#include "../common/service.hh"
+#include "../common/solve.hh"
+#include "../common/trace.hh"
+
+using namespace Gecode;
+using namespace std;
+
+// Native model of suitor_schedule.mzn, reading the same data files:
+//   suitor data/suitor_scheduleC_3.dzn
+//
+// Sun Shangxiang attends every meeting, so all meetings form one
+// unary resource. Every room is a unary resource of the meetings held
+// in it (optional tasks) and of the daily reserved slot of the room.
+// In every stage, as in suitor_schedule.mzn, a meeting has to wait for
+// the move from the room of the previous one; in stage C, the kung fu
+// lessons taking the last hours of the followed meetings are a unary
+// resource of their own, padded by minsep.
+
+const int ROOMS = 3;
+const char* roomNames[ROOMS] = {"Red", "Gold", "Blue"};
+
+
+class suitorOptions : public DriverOptions {
+public:
+    char* filename;
+
+    suitorOptions(const char* s) : DriverOptions(s, true), filename(NULL) {}
+
+    void parse(int& argc, char* argv[]) {
+        DriverOptions::parse(argc,argv);
+        if (argc != 2) return;
+        filename = argv[1];
+    }
+};
+
+
+class SuitorSchedule : public Script, public Trace::Depth {
+protected:
+    int n;          // Number of meetings
+    int ndays;
+    char stage;     // 'A', 'B' or 'C'
+    int lessontime;
+    int minsep;
+
+    // start[m] = 24 * day[m] + hour[m], all times in hours
+    IntVarArray start;
+    IntVarArray dur;
+    IntVarArray end;
+    IntVarArray room;  // 0 Red, 1 Gold, 2 Blue
+    // followed[m]: meeting m is followed by a kung fu lesson, stage C
+    BoolVarArray followed;
+    IntVar obj;
+
+public:
+    SuitorSchedule(const suitorOptions& opt) : Script(opt) {
+        Trace::failures(*this);
+        Dzn data(opt.filename, opt.request());
+        stage = data.ident("stage")[0];
+        n = data.integer("n");
+        ndays = data.integer("ndays");
+        lessontime = data.integer("lessontime");
+        minsep = data.integer("minsep");
+        int liuBei = data.integer("LiuBei");
+        int earliest = data.integer("earliest");
+        int latest = data.integer("latest");
+        vector<int> suitor = data.array("suitor");
+        vector<int> mintime = data.array("mintime");
+        vector<int> maxtime = data.array("maxtime");
+        vector<int> move = data.array("move");
+        vector<int> usedstart = data.array("usedstart");
+        vector<int> useddur = data.array("useddur");
+        if (n < 1 || ndays < 1)
+            data.error("n and ndays must be positive");
+        if (static_cast<int>(suitor.size()) != n)
+            data.error("suitor does not list n meetings");
+        for (int m = 0; m < n; m ++)
+            if (suitor[m] < 1 || ROOMS * suitor[m] > static_cast<int>(mintime.size()) ||
+                ROOMS * suitor[m] > static_cast<int>(maxtime.size()))
+                data.error("mintime and maxtime do not cover every suitor");
+        if (static_cast<int>(usedstart.size()) < ROOMS ||
+            static_cast<int>(useddur.size()) < ROOMS ||
+            static_cast<int>(move.size()) < ROOMS * ROOMS)
+            data.error("usedstart, useddur and move do not cover the rooms");
+
+        int horizon = 24 * ndays;
+        start = IntVarArray(*this, n, 0, horizon);
+        dur = IntVarArray(*this, n, 0, latest - earliest);
+        end = IntVarArray(*this, n, 0, horizon);
+        room = IntVarArray(*this, n, 0, ROOMS - 1);
+        followed = BoolVarArray(*this, n, 0, stage == 'C' ? 1 : 0);
+        IntVarArgs day(*this, n, 0, ndays - 1);
+        IntVarArgs hour(*this, n, earliest, latest);
+
+        for (int m = 0; m < n; m ++){
+            // Within the hours of a single day
+            rel(*this, start[m] == 24 * day[m] + hour[m]);
+            rel(*this, hour[m] + dur[m] <= latest);
+            rel(*this, end[m] == start[m] + dur[m]);
+
+            // Duration bounds of the suitor in the room; a lesson does
+            // not count towards the meeting
+            int s = suitor[m] - 1;
+            IntArgs lo(ROOMS), hi(ROOMS);
+            for (int r = 0; r < ROOMS; r ++){
+                lo[r] = mintime[s*ROOMS + r];
+                hi[r] = maxtime[s*ROOMS + r];
+            }
+            rel(*this, dur[m] - lessontime * followed[m] >= element(lo, room[m]));
+            rel(*this, dur[m] <= element(hi, room[m]));
+        }
+
+        // Sun Shangxiang attends all meetings
+        unary(*this, start, dur, end);
+
+        // The rooms, with the reserved slot of every day
+        for (int r = 0; r < ROOMS; r ++){
+            IntVarArgs s, p, e;
+            BoolVarArgs used;
+            for (int m = 0; m < n; m ++){
+                s << start[m];
+                p << dur[m];
+                e << end[m];
+                used << expr(*this, room[m] == r);
+            }
+            if (useddur[r] > 0)
+                for (int d = 0; d < ndays; d ++){
+                    int t = 24 * d + usedstart[r];
+                    s << IntVar(*this, t, t);
+                    p << IntVar(*this, useddur[r], useddur[r]);
+                    e << IntVar(*this, t + useddur[r], t + useddur[r]);
+                    used << BoolVar(*this, 1, 1);
+                }
+            unary(*this, s, p, e, used);
+        }
+
+        // Meetings of a suitor are held in the order given
+        for (int m1 = 0; m1 < n; m1 ++)
+            for (int m2 = m1 + 1; m2 < n; m2 ++)
+                if (suitor[m1] == suitor[m2])
+                    rel(*this, end[m1] <= start[m2]);
+
+        // Moving between the rooms of two meetings, whichever comes first
+        IntArgs moves(move);
+        for (int m1 = 0; m1 < n; m1 ++)
+            for (int m2 = m1 + 1; m2 < n; m2 ++){
+                IntVar t = expr(*this, element(moves, ROOMS * room[m1] + room[m2]));
+                BoolVar before = suitor[m1] == suitor[m2] ?
+                    BoolVar(*this, 1, 1) : BoolVar(*this, 0, 1);
+                rel(*this, before >> (end[m1] + t <= start[m2]));
+                rel(*this, !before >> (end[m2] + t <= start[m1]));
+            }
+
+        // Kung fu lessons, minsep apart
+        if (stage == 'C'){
+            IntVarArgs lesson(n);
+            for (int m = 0; m < n; m ++)
+                lesson[m] = expr(*this, end[m] - lessontime);
+            unary(*this, lesson, IntArgs::create(n, lessontime + minsep, 0), followed);
+        }
+
+        // 100 per lesson and the hours Liu Bei really spends with her
+        LinIntExpr value(0);
+        for (int m = 0; m < n; m ++)
+            if (suitor[m] == liuBei)
+                value = value + dur[m] + (100 - lessontime) * followed[m];
+            else
+                value = value + 100 * followed[m];
+        obj = IntVar(*this, 0, 100 * n + horizon);
+        rel(*this, obj == value);
+
+        // Lessons first, then rooms, long meetings of Liu Bei and short
+        // ones of the others, and finally the earliest start
+        branch(*this, followed, BOOL_VAR_NONE(), BOOL_VAL_MAX());
+        branch(*this, room, INT_VAR_SIZE_MIN(), INT_VAL_MIN());
+        IntVarArgs mine, others;
+        for (int m = 0; m < n; m ++)
+            if (suitor[m] == liuBei)
+                mine << dur[m];
+            else
+                others << dur[m];
+        branch(*this, mine, INT_VAR_NONE(), INT_VAL_MAX());
+        branch(*this, others, INT_VAR_NONE(), INT_VAL_MIN());
+        branchHeuristic(*this, start, opt, INT_VAL_MIN());
+    }
+
+    // The output of suitor_schedule.mzn. Lessons are listed in time
+    // order; the unused ones follow after the last day.
+    virtual void print(std::ostream& os) const {
+        os << "start = [";
+        for (int m = 0; m < n; m ++)
+            os << setw(2) << start[m].val() << (m != n-1 ? ", " : "");
+        os << "];\ndur  = [";
+        for (int m = 0; m < n; m ++)
+            os << setw(2) << dur[m].val() << (m != n-1 ? ", " : "");
+        os << "];\nroom = [";
+        for (int m = 0; m < n; m ++)
+            os << roomNames[room[m].val()] << (m != n-1 ? ", " : "");
+        os << "];\nkungfu = [";
+        vector<int> lessons;
+        for (int m = 0; m < n; m ++)
+            if (followed[m].val() == 1)
+                lessons.push_back(end[m].val() - lessontime);
+        sort(lessons.begin(), lessons.end());
+        int next = 24 * ndays + 1;
+        if (!lessons.empty())
+            next = max(next, lessons.back() + lessontime + minsep);
+        while (static_cast<int>(lessons.size()) < n){
+            lessons.push_back(next);
+            next += lessontime + minsep;
+        }
+        for (int k = 0; k < n; k ++)
+            os << lessons[k] << (k != n-1 ? ", " : "");
+        os << "];\nobj = " << obj.val() << ";" << endl;
+    }
+
+    SuitorSchedule(SHARE_PARAM SuitorSchedule& s)
+        : Script(SHARE_ARG s), Trace::Depth(s),
+          n(s.n), ndays(s.ndays), stage(s.stage),
+          lessontime(s.lessontime), minsep(s.minsep) {
+        start.update(*this, SHARE_ARG s.start);
+        dur.update(*this, SHARE_ARG s.dur);
+        end.update(*this, SHARE_ARG s.end);
+        room.update(*this, SHARE_ARG s.room);
+        followed.update(*this, SHARE_ARG s.followed);
+        obj.update(*this, SHARE_ARG s.obj);
+    }
+
+    virtual Space* copy(SHARE_VOID) {
+        return new SuitorSchedule(SHARE_ARG *this);
+    }
+
+    int get_obj_value() const{
+        return obj.val();
+    }
+
+    int get_obj_bound() const{
+        return obj.max();
+    }
+
+    virtual void constrain(const Space& _best) {
+        improve(static_cast<const SuitorSchedule&>(_best).get_obj_value());
+    }
+
+    void improve(int v) {
+        rel(*this, obj > v);
+    }
+};
+
+void parseOptions(suitorOptions& opt, int& argc, char* argv[]) {
+    opt.parse(argc, argv);
+    opt.solutions(0);
+}
+
+// Solve one service request
+bool serveSuitor(int argc, char* argv[], ostream& os) {
+    suitorOptions opt("Suitor Schedule");
+    opt.request(os);
+    parseOptions(opt, argc, argv);
+    if (opt.filename == NULL)
+        throw Exception("suitor", "no data file");
+    return Service::solve<SuitorSchedule, BAB, suitorOptions>(opt, os);
+}
+
+#ifndef DRIVER_NO_MAIN
+int main(int argc, char* argv[]) {
+    suitorOptions opt("Suitor Schedule");
+    parseOptions(opt, argc, argv);
+
+    if (opt.service()[0] != '\0')
+        return Service::serve(opt.service(), Service::threads(opt), serveSuitor);
+    else if (opt.filename == NULL) {
+        cerr << "usage: " << argv[0] << " [options] data.dzn\n";
+        return 1;
+    } else if (opt.processes() > 0)
+        Distributed::run<SuitorSchedule, BAB, Solve::Maximise<SuitorSchedule>>(opt, opt.processes());
+    else if (opt.anytime()[0] != '\0')
+        Anytime::run<SuitorSchedule, Solve::Maximise<SuitorSchedule>>(opt, opt.anytime());
+    else
+        Script::run<SuitorSchedule, BAB, suitorOptions>(opt);
+
+    return 0;
+}
+#endif